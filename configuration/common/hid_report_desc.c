@@ -22,7 +22,6 @@ const uint8_t hid_report_desc[]= {
 	0x75, 0x01,                    //     REPORT_SIZE (1)
 	0x95, 0x10,                    //     REPORT_COUNT (16)
 	0x81, 0x02,                    //     INPUT (Data,Var,Abs)
-	0x85, 0x02,                	   //     REPORT_ID (2)
 	0x05, 0x01,                    //     USAGE_PAGE (Generic Desktop)
 	0x09, 0x30,                    //     USAGE (X)
 	0x09, 0x31,                    //     USAGE (Y)
@@ -33,7 +32,39 @@ const uint8_t hid_report_desc[]= {
 	0x75, 0x08,                    //     REPORT_SIZE (8)
 	0x95, 0x04,                    //     REPORT_COUNT (4)
 	0x81, 0x02,                    //     INPUT (Data,Var,Abs)
-	0xC0,                          //     END_COLLECTION
+#if IS_ENABLED(CONFIG_HID_MODULE_REPORT_TIMESTAMP)
+	0x06, 0x00, 0xFF,              //     USAGE_PAGE (Vendor Defined 0xFF00)
+	0x09, 0x10,                    //     USAGE (Capture timestamp)
+	0x27, 0xFF, 0xFF, 0x00, 0x00,  //     LOGICAL_MAXIMUM (65535)
+	0x75, 0x10,                    //     REPORT_SIZE (16)
+	0x95, 0x01,                    //     REPORT_COUNT (1)
+	0x81, 0x02,                    //     INPUT (Data,Var,Abs)
+#endif
+	0xC0,                          //   END_COLLECTION
+	0x85, 0x03,                    //   REPORT_ID (3)
+	0x06, 0x00, 0xFF,              //   USAGE_PAGE (Vendor Defined 0xFF00)
+	0x09, 0x01,                    //   USAGE (Tuning parameters)
+	0x15, 0x00,                    //   LOGICAL_MINIMUM (0)
+	0x26, 0xFF, 0x00,              //   LOGICAL_MAXIMUM (255)
+	0x75, 0x08,                    //   REPORT_SIZE (8)
+	0x95, 0x10,                    //   REPORT_COUNT (16)
+	0xB1, 0x02,                    //   FEATURE (Data,Var,Abs)
+	0x85, 0x04,                    //   REPORT_ID (4)
+	0x09, 0x02,                    //   USAGE (Encoder parameters)
+	0x95, 0x04,                    //   REPORT_COUNT (4)
+	0xB1, 0x02,                    //   FEATURE (Data,Var,Abs)
+	0x85, 0x05,                    //   REPORT_ID (5)
+	0x09, 0x03,                    //   USAGE (Axis mapping)
+	0x95, 0x30,                    //   REPORT_COUNT (48)
+	0xB1, 0x02,                    //   FEATURE (Data,Var,Abs)
+	0x85, 0x06,                    //   REPORT_ID (6)
+	0x09, 0x04,                    //   USAGE (Odometry)
+	0x95, 0x10,                    //   REPORT_COUNT (16)
+	0xB1, 0x02,                    //   FEATURE (Data,Var,Abs)
+	0x85, 0x07,                    //   REPORT_ID (7)
+	0x09, 0x05,                    //   USAGE (Device clock)
+	0x95, 0x04,                    //   REPORT_COUNT (4)
+	0xB1, 0x02,                    //   FEATURE (Data,Var,Abs)
 	0xC0                           // END_COLLECTION
 };
 
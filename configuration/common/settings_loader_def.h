@@ -23,4 +23,10 @@ static inline void get_req_modules(struct module_flags *mf)
 #if CONFIG_CAF_BLE_ADV
 	module_flags_set_bit(mf, MODULE_IDX(ble_adv));
 #endif
+#if CONFIG_HID_MODULE
+	/* The HID service must be registered before the CCC values of bonded
+	 * peers are restored.
+	 */
+	module_flags_set_bit(mf, MODULE_IDX(hid_module));
+#endif
 }
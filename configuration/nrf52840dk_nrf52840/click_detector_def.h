@@ -20,9 +20,9 @@ const struct
 static const struct click_detector_config click_detector_config[] = {
 	{
 		.key_id = KEY_ID(0x00, 0x00),
-		.consume_button_event = true,
+		.consume_button_event = false,
 	},
 	{
 		.key_id = KEY_ID(0x00, 0x01),
-		.consume_button_event = true,
+		.consume_button_event = false,
 	}};
\ No newline at end of file
@@ -1,7 +1,10 @@
+#include <kernel.h>
 #include <devicetree.h>
 #include <drivers/sensor.h>
 #include <drivers/gpio.h>
 
+#include "qdec_gpio.h"
+
 #include <logging/log.h>
 LOG_MODULE_REGISTER(sensor_qdec_gpio, CONFIG_SENSOR_LOG_LEVEL);
 
@@ -22,6 +25,17 @@ struct qdec_gpio_data
     uint8_t prev_state_b;
     int32_t counter;
     int32_t fetched_counter;
+    /* Ticks between the last two fetches, also when counting cumulatively */
+    int32_t fetched_ticks;
+    /* Ticks since boot, never reset by a fetch */
+    atomic_t total;
+#if IS_ENABLED(CONFIG_QDEC_GPIO_EDGE_TIMESTAMP)
+    /* Cycle count of the first edge since the last fetch */
+    uint32_t edge_cycles;
+    uint32_t fetched_edge_cycles;
+    bool edge_pending;
+    bool fetched_edge;
+#endif
     sensor_trigger_handler_t data_ready_handler;
 };
 
@@ -36,17 +50,28 @@ struct qdec_gpio_conf
 
 static int qdec_gpio_sample_fetch(const struct device *dev, enum sensor_channel chan)
 {
-    if (!(chan == SENSOR_CHAN_ALL || chan == SENSOR_CHAN_ROTATION))
+    if (!(chan == SENSOR_CHAN_ALL || chan == SENSOR_CHAN_ROTATION ||
+          chan == (enum sensor_channel)QDEC_GPIO_CHAN_TICKS))
     {
-        LOG_ERR("Invalid channel %d. Only SENSOR_CHAN_ALL and SENSOR_CHAN_ROTATION are supported.", chan);
+        LOG_ERR("Invalid channel %d. Only SENSOR_CHAN_ALL, SENSOR_CHAN_ROTATION and QDEC_GPIO_CHAN_TICKS are supported.", chan);
         return -ENOTSUP;
     }
 
     struct qdec_gpio_data *data = dev->data;
     unsigned int key = irq_lock();
+#if IS_ENABLED(CONFIG_QDEC_GPIO_CUMULATIVE)
+    data->fetched_ticks = data->counter - data->fetched_counter;
+#else
+    data->fetched_ticks = data->counter;
+#endif
     data->fetched_counter = data->counter;
 #if !IS_ENABLED(CONFIG_QDEC_GPIO_CUMULATIVE)
     data->counter = 0;
+#endif
+#if IS_ENABLED(CONFIG_QDEC_GPIO_EDGE_TIMESTAMP)
+    data->fetched_edge_cycles = data->edge_cycles;
+    data->fetched_edge = data->edge_pending;
+    data->edge_pending = false;
 #endif
     irq_unlock(key);
 
@@ -55,15 +80,38 @@ static int qdec_gpio_sample_fetch(const struct device *dev, enum sensor_channel
 
 static int qdec_gpio_channel_get(const struct device *dev, enum sensor_channel chan, struct sensor_value *val)
 {
+    const struct qdec_gpio_conf *conf = dev->config;
+    const struct qdec_gpio_data *data = dev->data;
+
+    if (chan == (enum sensor_channel)QDEC_GPIO_CHAN_TICKS)
+    {
+        val->val1 = data->fetched_ticks;
+        val->val2 = 0;
+        return 0;
+    }
+
+    if (chan == (enum sensor_channel)QDEC_GPIO_CHAN_TOTAL_TICKS)
+    {
+        val->val1 = (int32_t)atomic_get(&data->total);
+        val->val2 = 0;
+        return 0;
+    }
+
+#if IS_ENABLED(CONFIG_QDEC_GPIO_EDGE_TIMESTAMP)
+    if (chan == (enum sensor_channel)QDEC_GPIO_CHAN_EDGE_CYCLES)
+    {
+        val->val1 = (int32_t)data->fetched_edge_cycles;
+        val->val2 = data->fetched_edge;
+        return 0;
+    }
+#endif
+
     if (chan != SENSOR_CHAN_ROTATION)
     {
-        LOG_ERR("Invalid channel %d. Only SENSOR_CHAN_ROTATION is supported.", chan);
+        LOG_ERR("Invalid channel %d. Only SENSOR_CHAN_ROTATION, QDEC_GPIO_CHAN_TICKS and QDEC_GPIO_CHAN_TOTAL_TICKS are supported.", chan);
         return -ENOTSUP;
     }
 
-    const struct qdec_gpio_conf *conf = dev->config;
-    const struct qdec_gpio_data *data = dev->data;
-
     int32_t steps = conf->ticks_per_rotation;
 
     int32_t counter = data->fetched_counter;
@@ -145,6 +193,14 @@ static void qdec_line_callback(const struct device *port, struct gpio_callback *
     }
 
     data->counter += lookup_table[movement_index];
+    atomic_add(&data->total, lookup_table[movement_index]);
+#if IS_ENABLED(CONFIG_QDEC_GPIO_EDGE_TIMESTAMP)
+    if (!data->edge_pending && lookup_table[movement_index])
+    {
+        data->edge_cycles = k_cycle_get_32();
+        data->edge_pending = true;
+    }
+#endif
 
     if (data->data_ready_handler)
     {
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _QDEC_GPIO_H_
+#define _QDEC_GPIO_H_
+
+#include <drivers/sensor.h>
+
+/** @brief Private sensor channels of the GPIO quadrature decoder. */
+enum qdec_gpio_channel {
+	/** Ticks counted in the fetched sample, in val1. Unlike
+	 *  SENSOR_CHAN_ROTATION, no precision is lost in a unit conversion.
+	 *  Always the ticks since the previous fetch, also with
+	 *  CONFIG_QDEC_GPIO_CUMULATIVE.
+	 */
+	QDEC_GPIO_CHAN_TICKS = SENSOR_CHAN_PRIV_START,
+	/** Ticks counted since boot, in val1, wrapping at 32 bits. Read live
+	 *  without a sample fetch, so that it can be polled by another reader
+	 *  than the one fetching the samples.
+	 */
+	QDEC_GPIO_CHAN_TOTAL_TICKS,
+	/** k_cycle_get_32() at the first edge counted in the fetched sample,
+	 *  in val1. val2 is 1 if the sample has an edge, 0 otherwise. Only
+	 *  available with CONFIG_QDEC_GPIO_EDGE_TIMESTAMP.
+	 */
+	QDEC_GPIO_CHAN_EDGE_CYCLES,
+};
+
+#endif /* _QDEC_GPIO_H_ */
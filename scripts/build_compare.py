@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+"""Compare the flash, RAM and CPU use of two builds.
+
+Flash and RAM are summed from the allocated sections of zephyr/zephyr.elf
+in each build folder: code and read-only data count as flash, initialized
+data as both, and zero-initialized data and noinit as RAM. CPU use is taken
+from the output of the 'kernel threads' shell command, captured from
+each build with CONFIG_THREAD_RUNTIME_STATS=y and CONFIG_THREAD_NAME=y
+after the same run, if given.
+Requires pyelftools.
+
+Examples:
+    build_compare.py build_dev build_prod
+    build_compare.py build_dev build_prod --threads dev_threads.txt prod_threads.txt
+"""
+
+import argparse
+import os
+import re
+import sys
+
+from elftools.elf.constants import SH_FLAGS
+from elftools.elf.elffile import ELFFile
+
+
+def memory_use(build_dir):
+    path = os.path.join(build_dir, "zephyr", "zephyr.elf")
+    flash = ram = 0
+    with open(path, "rb") as f:
+        for section in ELFFile(f).iter_sections():
+            flags = section["sh_flags"]
+            if not flags & SH_FLAGS.SHF_ALLOC or section["sh_size"] == 0:
+                continue
+            size = section["sh_size"]
+            if section["sh_type"] == "SHT_NOBITS":
+                ram += size
+            elif flags & SH_FLAGS.SHF_WRITE:
+                # Initialized data is stored in flash and copied to RAM.
+                flash += size
+                ram += size
+            else:
+                flash += size
+    return flash, ram
+
+
+THREAD_RE = re.compile(r"^\s*\*?\s*0x[0-9a-fA-F]+\s+(\S+)")
+CYCLES_RE = re.compile(r"Total execution cycles:\s*(\d+)\s*\((\d+)\s*%\)")
+
+
+def thread_cpu(path):
+    """Returns {thread name: percent of execution cycles}."""
+    usage = {}
+    name = None
+    with open(path, errors="replace") as f:
+        for line in f:
+            match = THREAD_RE.match(line)
+            if match:
+                name = match.group(1)
+                continue
+            match = CYCLES_RE.search(line)
+            if match and name:
+                usage[name] = int(match.group(2))
+    return usage
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("first", help="first build folder, e.g. build_dev")
+    parser.add_argument("second", help="second build folder, e.g. build_prod")
+    parser.add_argument("--threads", nargs=2, metavar=("FIRST", "SECOND"),
+                        help="'kernel threads' output captured from each build")
+    args = parser.parse_args()
+
+    first = memory_use(args.first)
+    second = memory_use(args.second)
+    print("%-8s %10s %10s %10s" % ("", args.first, args.second, "change"))
+    for label, a, b in (("FLASH", first[0], second[0]), ("RAM", first[1], second[1])):
+        print("%-8s %10d %10d %+10d" % (label, a, b, b - a))
+
+    if args.threads:
+        first_cpu = thread_cpu(args.threads[0])
+        second_cpu = thread_cpu(args.threads[1])
+        if not first_cpu or not second_cpu:
+            sys.exit("No runtime statistics found, build with CONFIG_THREAD_RUNTIME_STATS=y")
+        print()
+        print("%-20s %9s %9s" % ("CPU [%]", args.first, args.second))
+        for name in sorted(set(first_cpu) | set(second_cpu)):
+            print("%-20s %9s %9s" % (name, first_cpu.get(name, "-"), second_cpu.get(name, "-")))
+
+
+if __name__ == "__main__":
+    main()
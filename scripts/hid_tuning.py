@@ -0,0 +1,191 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+"""Read and write the tuning parameters of the Wheelchair Ergometer.
+
+The HID parameters are exchanged through HID feature report 3, the encoder
+parameters through feature report 4 and the joystick axis mapping through
+feature report 5, over either Bluetooth or USB. Feature report 6 holds the
+odometry of the device, which is reset by writing the report, and feature
+report 7 the device clock used for the timestamps of the game pad report.
+Changes are stored in flash by the device a few seconds after the last write.
+Requires the hidapi Python package (pip install hidapi).
+
+Examples:
+    hid_tuning.py get
+    hid_tuning.py set max_turn_rate_deg_per_sec=60 moving_average_alpha_permille=500
+    hid_tuning.py set x_signal=2 y_signal=1 y_invert=1 x_expo_permille=300
+    hid_tuning.py set y_lowpass_cutoff_dhz=50 y_deadzone_permille=20
+    hid_tuning.py reset-odometry
+    hid_tuning.py clock
+
+Axis signals: 0 neutral, 1 translation, 2 turn, 3 left wheel, 4 right wheel.
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+import hid
+
+VENDOR_ID = 0x1915
+PRODUCT_ID = 0x52DE
+
+# Feature report ID and field layout of each parameter block, as (name, struct format).
+REPORTS = {
+    # struct hid_tuning_params in src/modules/hid_profile.h
+    3: (
+        ("max_speed_mm_per_sec", "H"),
+        ("max_turn_rate_deg_per_sec", "H"),
+        ("sensitivity_start_permille", "H"),
+        ("sensitivity_end_permille", "H"),
+        ("sensitivity_alpha_permille", "H"),
+        ("turn_scaling_permille", "H"),
+        ("cylinder_diameter_mm", "H"),
+        ("inter_wheel_distance_mm", "H"),
+    ),
+    # struct encoder_params in src/modules/encoder_params.h
+    4: (
+        ("moving_average_alpha_permille", "H"),
+        ("delta_time_msec", "H"),
+    ),
+    # struct hid_axis_map in src/modules/hid_profile.h
+    5: tuple(
+        field
+        for axis in ("x", "y", "z", "rz")
+        for field in (
+            (axis + "_signal", "B"),
+            (axis + "_invert", "B"),
+            (axis + "_expo_permille", "H"),
+            # struct axis_filter_config in src/util/axis_filter.h
+            (axis + "_lowpass_cutoff_dhz", "H"),
+            (axis + "_slew_rate_permille", "H"),
+            (axis + "_deadzone_permille", "H"),
+            (axis + "_knee_permille", "H"),
+        )
+    ),
+    # struct odometry_report in src/modules/hid_module.c, read-only
+    6: (
+        ("distance_mm", "i"),
+        ("x_mm", "i"),
+        ("y_mm", "i"),
+        ("heading_mdeg", "i"),
+    ),
+    # struct clock_report in src/modules/hid_module.c, read-only
+    7: (
+        ("uptime_ms", "I"),
+    ),
+}
+ODOMETRY_REPORT_ID = 6
+CLOCK_REPORT_ID = 7
+READ_ONLY_REPORT_IDS = (ODOMETRY_REPORT_ID, CLOCK_REPORT_ID)
+ALL_FIELDS = [name for report_id, fields in REPORTS.items() if report_id not in READ_ONLY_REPORT_IDS
+              for name, _ in fields]
+
+
+def open_device():
+    dev = hid.device()
+    try:
+        dev.open(VENDOR_ID, PRODUCT_ID)
+    except OSError:
+        sys.exit("Wheelchair Ergometer not found (VID 0x%04X, PID 0x%04X)" % (VENDOR_ID, PRODUCT_ID))
+    return dev
+
+
+def report_format(report_id):
+    return "<" + "".join(fmt for _, fmt in REPORTS[report_id])
+
+
+def read_report(dev, report_id):
+    size = struct.calcsize(report_format(report_id))
+    data = dev.get_feature_report(report_id, size + 1)
+    # Some platforms return the report ID as the first byte.
+    if len(data) == size + 1:
+        data = data[1:]
+    values = struct.unpack(report_format(report_id), bytes(data[:size]))
+    return dict(zip((name for name, _ in REPORTS[report_id]), values))
+
+
+def write_report(dev, report_id, params):
+    payload = struct.pack(report_format(report_id), *(params[name] for name, _ in REPORTS[report_id]))
+    dev.send_feature_report([report_id] + list(payload))
+
+
+def read_all(dev):
+    return {report_id: read_report(dev, report_id) for report_id in REPORTS}
+
+
+def print_params(params):
+    for report_params in params.values():
+        for field, value in report_params.items():
+            print("%-30s %d" % (field, value))
+
+
+def clock_offset(dev, rounds=20):
+    """Estimates host time minus device uptime [ms] from the read with the shortest round trip.
+
+    The device clock is assumed to be sampled halfway through the round trip.
+    Adding the offset to a report timestamp, after unwrapping its 16 bits against
+    the current uptime, gives the host time at which the sample was captured.
+    """
+    best = None
+    for _ in range(rounds):
+        start = time.monotonic()
+        uptime_ms = read_report(dev, CLOCK_REPORT_ID)["uptime_ms"]
+        end = time.monotonic()
+        round_trip_ms = (end - start) * 1000.0
+        if best is None or round_trip_ms < best[0]:
+            best = (round_trip_ms, (start + end) * 500.0 - uptime_ms)
+    return best
+
+
+def parse_assignments(assignments):
+    changes = {}
+    for assignment in assignments:
+        name, sep, value = assignment.partition("=")
+        if not sep or name not in ALL_FIELDS:
+            sys.exit("Invalid assignment '%s', expected one of: %s" % (assignment, ", ".join(ALL_FIELDS)))
+        changes[name] = int(value, 0)
+    return changes
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+    sub.add_parser("get", help="print the current tuning parameters")
+    set_parser = sub.add_parser("set", help="change one or more tuning parameters")
+    set_parser.add_argument("assignments", nargs="+", metavar="name=value")
+    sub.add_parser("reset-odometry", help="reset distance, position and heading to zero")
+    sub.add_parser("clock", help="estimate the offset of the device clock to the host clock")
+    args = parser.parse_args()
+
+    dev = open_device()
+    params = read_all(dev)
+
+    if args.command == "set":
+        changes = parse_assignments(args.assignments)
+        for report_id, report_params in params.items():
+            if any(name in report_params for name in changes):
+                report_params.update((k, v) for k, v in changes.items() if k in report_params)
+                write_report(dev, report_id, report_params)
+        params = read_all(dev)
+    elif args.command == "reset-odometry":
+        write_report(dev, ODOMETRY_REPORT_ID, params[ODOMETRY_REPORT_ID])
+        params = read_all(dev)
+    elif args.command == "clock":
+        round_trip_ms, offset_ms = clock_offset(dev)
+        print("%-30s %.3f" % ("clock_offset_ms", offset_ms))
+        print("%-30s %.3f" % ("round_trip_ms", round_trip_ms))
+        dev.close()
+        return
+
+    print_params(params)
+    dev.close()
+
+
+if __name__ == "__main__":
+    main()
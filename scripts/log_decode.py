@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+"""Decode the dictionary-based log output of a production build.
+
+The production overlay (configuration/common/overlay-production.conf) makes
+the target send log messages in binary form, without formatting them. This
+script formats them on the host using the log database generated by the
+build (build/zephyr/log_dictionary.json) and the dictionary parser of Zephyr.
+The log is read from a file recorded from the UART, or live from a serial
+port until interrupted. Requires ZEPHYR_BASE to be set, and pyserial for
+--serial.
+
+Examples:
+    log_decode.py build/zephyr/log_dictionary.json uart.bin
+    log_decode.py build/zephyr/log_dictionary.json --serial /dev/ttyACM0
+"""
+
+import argparse
+import os
+import sys
+
+
+def load_parser(database_path):
+    zephyr_base = os.environ.get("ZEPHYR_BASE")
+    if not zephyr_base:
+        sys.exit("ZEPHYR_BASE is not set")
+    sys.path.insert(0, os.path.join(zephyr_base, "scripts", "logging", "dictionary"))
+
+    import dictionary_parser
+    from dictionary_parser.log_database import LogDatabase
+
+    database = LogDatabase.read_json_database(database_path)
+    if database is None:
+        sys.exit("Cannot read log database %s" % database_path)
+    return dictionary_parser.get_parser(database)
+
+
+def read_serial(port, baud):
+    import serial
+
+    data = bytearray()
+    with serial.Serial(port, baud, timeout=0.5) as ser:
+        try:
+            while True:
+                data += ser.read(ser.in_waiting or 1)
+        except KeyboardInterrupt:
+            pass
+    return bytes(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("database", help="log_dictionary.json of the build running on the target")
+    parser.add_argument("input", nargs="?", help="binary log recorded from the UART")
+    parser.add_argument("--serial", help="serial port to read the log from")
+    parser.add_argument("--baud", type=int, default=115200)
+    args = parser.parse_args()
+
+    if bool(args.input) == bool(args.serial):
+        sys.exit("Give either an input file or --serial")
+
+    log_parser = load_parser(args.database)
+    if args.serial:
+        data = read_serial(args.serial, args.baud)
+    else:
+        with open(args.input, "rb") as f:
+            data = f.read()
+
+    if not log_parser.parse_log_data(data):
+        sys.exit("Log data could not be fully decoded")
+
+
+if __name__ == "__main__":
+    main()
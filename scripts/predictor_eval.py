@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+"""Evaluate the HID axis predictor on a recorded trace.
+
+Runs the same least-squares extrapolation as src/util/predictor.c over one
+column of a CSV trace, sampled at a fixed period, and reports:
+  - the lead gained, from the peak of the cross-correlation with the input
+  - the RMS error against the input one horizon later, with and without
+    prediction
+  - the largest overshoot, where the prediction is further from zero than
+    the input one horizon later
+
+Example:
+    predictor_eval.py trace.csv --column turn --period-ms 10 --horizon-ms 50
+"""
+
+import argparse
+import csv
+import math
+
+
+def predict(samples, history, horizon, max_lead):
+    center = (history - 1) / 2.0
+    square_sum = history * (history * history - 1) / 12.0
+    ring = [0.0] * history
+    out = []
+    for x in samples:
+        ring = ring[1:] + [x]
+        mean = sum(ring) / history
+        slope = sum((i - center) * y for i, y in enumerate(ring)) / square_sum
+        fit = mean + slope * center
+        lead = min(max(fit + slope * horizon - x, -max_lead), max_lead)
+        prediction = x + lead
+        out.append(0.0 if prediction * x < 0.0 else prediction)
+    return out
+
+
+def best_shift(reference, signal, max_shift):
+    """Shift in samples that best aligns signal with reference, positive if signal leads."""
+    def correlation(shift):
+        pairs = zip(reference[shift:], signal) if shift >= 0 else zip(reference, signal[-shift:])
+        return sum(a * b for a, b in pairs)
+    return max(range(-max_shift, max_shift + 1), key=correlation)
+
+
+def rms(errors):
+    return math.sqrt(sum(e * e for e in errors) / max(len(errors), 1))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("trace", help="CSV file with a header row")
+    parser.add_argument("--column", required=True, help="column holding the axis signal")
+    parser.add_argument("--period-ms", type=float, required=True, help="sample period of the trace")
+    parser.add_argument("--horizon-ms", type=float, default=50, help="CONFIG_HID_MODULE_PREDICTOR_HORIZON_MS")
+    parser.add_argument("--max-lead", type=float, default=0.15,
+                        help="CONFIG_HID_MODULE_PREDICTOR_MAX_LEAD_PERMILLE / 1000, in units of the trace")
+    parser.add_argument("--history", type=int, default=6, help="CONFIG_PREDICTOR_HISTORY")
+    args = parser.parse_args()
+
+    with open(args.trace, newline="") as f:
+        samples = [float(row[args.column]) for row in csv.DictReader(f)]
+
+    horizon = args.horizon_ms / args.period_ms
+    steps = int(round(horizon))
+    predicted = predict(samples, args.history, horizon, args.max_lead)
+
+    future = samples[steps:]
+    baseline = [x - y for x, y in zip(samples, future)]
+    errors = [p - y for p, y in zip(predicted, future)]
+    overshoot = max((abs(p) - abs(y) for p, y in zip(predicted, future) if p * y >= 0), default=0.0)
+    shift = best_shift(samples, predicted, 4 * max(steps, 1))
+
+    print("samples                 %d" % len(samples))
+    print("lead gained             %.1f ms" % (shift * args.period_ms))
+    print("RMS error, unpredicted  %.4f" % rms(baseline))
+    print("RMS error, predicted    %.4f" % rms(errors))
+    print("max overshoot           %.4f" % max(overshoot, 0.0))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+"""Record the raw encoder stream of the Wheelchair Ergometer.
+
+Subscribes to the streaming service (src/modules/stream_module.c), writes
+every sample to a CSV file and prints the throughput and the drop counters
+once a second. The device must be built with the stream overlay and bonded
+with this computer. Requires the bleak Python package (pip install bleak).
+
+Example:
+    stream_capture.py --duration 60 session.csv
+"""
+
+import argparse
+import asyncio
+import csv
+import struct
+import sys
+import time
+
+from bleak import BleakClient, BleakScanner
+
+DEVICE_NAME = "Wheelchair Ergometer"
+DATA_UUID = "6e570001-7d3a-4b8e-9f1c-3b5d0c7a2e10"
+STATS_UUID = "6e570002-7d3a-4b8e-9f1c-3b5d0c7a2e10"
+
+# struct stream_header and struct stream_sample in src/modules/stream_module.c
+HEADER = struct.Struct("<HH")
+SAMPLE = struct.Struct("<Hhh")
+# struct stream_stats in src/modules/stream_module.c
+STATS = struct.Struct("<IIIII")
+STATS_FIELDS = ("captured", "dropped", "saturated", "notifications", "notify_failed")
+
+
+class Capture:
+    def __init__(self, writer):
+        self.writer = writer
+        self.expected_sequence = None
+        self.lost_notifications = 0
+        self.dropped = 0
+        self.samples = 0
+        self.payload_bytes = 0
+        self.last_timestamp = None
+        self.time_ms = 0
+
+    def on_notify(self, _sender, data):
+        sequence, dropped = HEADER.unpack_from(data)
+        if self.expected_sequence is not None and sequence != self.expected_sequence:
+            self.lost_notifications += (sequence - self.expected_sequence) & 0xFFFF
+        self.expected_sequence = (sequence + 1) & 0xFFFF
+        self.dropped += dropped
+        self.payload_bytes += len(data)
+
+        for timestamp, ticks_a, ticks_b in SAMPLE.iter_unpack(data[HEADER.size:]):
+            # Unwrap the 16 bit device timestamp.
+            if self.last_timestamp is not None:
+                self.time_ms += (timestamp - self.last_timestamp) & 0xFFFF
+            self.last_timestamp = timestamp
+            self.writer.writerow((self.time_ms, ticks_a, ticks_b))
+            self.samples += 1
+
+
+async def find_device():
+    device = await BleakScanner.find_device_by_filter(lambda d, _: d.name == DEVICE_NAME)
+    if device is None:
+        sys.exit("Wheelchair Ergometer not found")
+    return device
+
+
+async def run(args, writer):
+    capture = Capture(writer)
+    async with BleakClient(await find_device()) as client:
+        await client.start_notify(DATA_UUID, capture.on_notify)
+        start = time.monotonic()
+        prev_bytes = 0
+        while time.monotonic() - start < args.duration:
+            await asyncio.sleep(1.0)
+            rate = capture.payload_bytes - prev_bytes
+            prev_bytes = capture.payload_bytes
+            print("%8d samples  %6.1f kB/s  %d dropped  %d notifications lost"
+                  % (capture.samples, rate / 1000.0, capture.dropped, capture.lost_notifications))
+        await client.stop_notify(DATA_UUID)
+        stats = STATS.unpack(await client.read_gatt_char(STATS_UUID))
+
+    elapsed = time.monotonic() - start
+    print("Average throughput %.1f kB/s, %.0f samples/s"
+          % (capture.payload_bytes / elapsed / 1000.0, capture.samples / elapsed))
+    for name, value in zip(STATS_FIELDS, stats):
+        print("%-30s %d" % ("device_" + name, value))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("output", help="CSV file of time_ms, ticks_a, ticks_b")
+    parser.add_argument("--duration", type=float, default=30.0, help="recording length in seconds")
+    args = parser.parse_args()
+
+    with open(args.output, "w", newline="") as f:
+        writer = csv.writer(f)
+        writer.writerow(("time_ms", "ticks_a", "ticks_b"))
+        asyncio.run(run(args, writer))
+
+
+if __name__ == "__main__":
+    main()
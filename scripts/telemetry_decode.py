@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+"""Decode the binary telemetry stream of the Wheelchair Ergometer into CSV.
+
+Reads the frames written by src/util/telemetry.c from a file (e.g. recorded
+with JLinkRTTLogger from RTT channel 1) or from a serial port, and writes one
+CSV row per frame. Bytes that are not part of a valid frame, such as log
+output sharing the UART, are skipped.
+
+Examples:
+    telemetry_decode.py rtt.bin -o hid.csv
+    telemetry_decode.py --serial /dev/ttyACM0 --baud 115200 -o hid.csv
+"""
+
+import argparse
+import csv
+import struct
+import sys
+
+SYNC = b"\xa5\x5a"
+# type, payload length, sequence, uptime_ms
+HEADER = struct.Struct("<BBHI")
+CRC = struct.Struct("<H")
+
+# Payload layout of each frame type, as (name, struct format).
+FRAME_TYPES = {
+    # struct hid_telemetry in src/modules/hid_module.c
+    1: (
+        ("speed", "f"),
+        ("speed_clamped", "f"),
+        ("turn_rate", "f"),
+        ("output_turn_rate", "f"),
+        ("difference_sensitivity", "f"),
+        ("filtered_difference_sensitivity", "f"),
+        ("x", "B"),
+        ("y", "B"),
+        ("z", "B"),
+        ("rz", "B"),
+    ),
+}
+
+
+def crc16_ccitt(data, crc=0xFFFF):
+    # Same as crc16_ccitt() of Zephyr: polynomial 0x1021, reflected.
+    for byte in data:
+        byte ^= crc & 0xFF
+        byte ^= (byte << 4) & 0xFF
+        crc = ((byte << 8) | (crc >> 8)) ^ (byte >> 4) ^ (byte << 3)
+        crc &= 0xFFFF
+    return crc
+
+
+def frames(chunks):
+    """Yields (type, sequence, uptime_ms, payload) of every valid frame."""
+    buf = b""
+    for chunk in chunks:
+        buf += chunk
+        while True:
+            start = buf.find(SYNC)
+            if start < 0:
+                buf = buf[-1:]
+                break
+            buf = buf[start:]
+            if len(buf) < len(SYNC) + HEADER.size:
+                break
+            frame_type, length, sequence, uptime_ms = HEADER.unpack_from(buf, len(SYNC))
+            end = len(SYNC) + HEADER.size + length
+            if len(buf) < end + CRC.size:
+                break
+            (crc,) = CRC.unpack_from(buf, end)
+            if crc != crc16_ccitt(buf[len(SYNC):end]):
+                # Not a frame, resynchronize after this sync pattern.
+                buf = buf[1:]
+                continue
+            yield frame_type, sequence, uptime_ms, buf[len(SYNC) + HEADER.size:end]
+            buf = buf[end + CRC.size:]
+
+
+def read_file(path):
+    with open(path, "rb") as f:
+        while True:
+            chunk = f.read(4096)
+            if not chunk:
+                return
+            yield chunk
+
+
+def read_serial(port, baud):
+    import serial
+
+    with serial.Serial(port, baud, timeout=1) as ser:
+        while True:
+            yield ser.read(ser.in_waiting or 1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", nargs="?", help="binary file with the recorded stream")
+    parser.add_argument("--serial", help="serial port to read the stream from")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--type", type=int, default=1, help="frame type to decode (default: 1, HID)")
+    parser.add_argument("-o", "--output", help="CSV file (default: stdout)")
+    args = parser.parse_args()
+
+    if bool(args.input) == bool(args.serial):
+        sys.exit("Give either an input file or --serial")
+    if args.type not in FRAME_TYPES:
+        sys.exit("Unknown frame type %d" % args.type)
+
+    fields = FRAME_TYPES[args.type]
+    payload = struct.Struct("<" + "".join(fmt for _, fmt in fields))
+    chunks = read_serial(args.serial, args.baud) if args.serial else read_file(args.input)
+    out = open(args.output, "w", newline="") if args.output else sys.stdout
+    writer = csv.writer(out)
+    writer.writerow(("uptime_ms", "sequence") + tuple(name for name, _ in fields))
+
+    expected = None
+    lost = 0
+    try:
+        for frame_type, sequence, uptime_ms, data in frames(chunks):
+            if expected is not None:
+                lost += (sequence - expected) & 0xFFFF
+            expected = (sequence + 1) & 0xFFFF
+            if frame_type != args.type or len(data) != payload.size:
+                continue
+            writer.writerow((uptime_ms, sequence) + payload.unpack(data))
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if out is not sys.stdout:
+            out.close()
+    print("%d frames lost or dropped" % lost, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
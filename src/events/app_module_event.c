@@ -5,6 +5,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "app_module_event.h"
 #include "common_module_event.h"
@@ -54,6 +55,8 @@ static char *get_evt_type_str(enum app_module_event_type type)
 		return "APP_EVT_LTE_DISCONNECT";
 	case APP_EVT_SHUTDOWN_READY:
 		return "APP_EVT_SHUTDOWN_READY";
+	case APP_EVT_POWER_STATE:
+		return "APP_EVT_POWER_STATE";
 	case APP_EVT_ERROR:
 		return "APP_EVT_ERROR";
 	default:
@@ -61,6 +64,22 @@ static char *get_evt_type_str(enum app_module_event_type type)
 	}
 }
 
+static char *power_state2str(enum app_power_state state)
+{
+	switch (state) {
+	case APP_POWER_ACTIVE:
+		return "ACTIVE";
+	case APP_POWER_CONNECTED_IDLE:
+		return "CONNECTED_IDLE";
+	case APP_POWER_DISCONNECTED:
+		return "DISCONNECTED";
+	case APP_POWER_IDLE:
+		return "IDLE";
+	default:
+		return "Unknown state";
+	}
+}
+
 static void log_event(const struct app_event_header *aeh)
 {
 	const struct app_module_event *event = cast_app_module_event(aeh);
@@ -69,6 +88,10 @@ static void log_event(const struct app_event_header *aeh)
 	if (event->type == APP_EVT_ERROR) {
 		APP_EVENT_MANAGER_LOG(aeh, "%s - Error code %d",
 				get_evt_type_str(event->type), event->data.err);
+	} else if (event->type == APP_EVT_POWER_STATE) {
+		APP_EVENT_MANAGER_LOG(aeh, "%s - %s",
+				get_evt_type_str(event->type),
+				power_state2str(event->data.power_state));
 	} else if (event->type == APP_EVT_DATA_GET) {
 		for (int i = 0; i < event->count; i++) {
 			strcat(data_types, type2str(event->data_list[i]));
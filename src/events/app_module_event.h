@@ -66,12 +66,33 @@ enum app_module_event_type {
 	 */
 	APP_EVT_SHUTDOWN_READY,
 
+	/** The power state of the device changed. The new state is attached in the event
+	 *  structure.
+	 */
+	APP_EVT_POWER_STATE,
+
 	/** An irrecoverable error has occurred in the application module. Error details are
 	 *  attached in the event structure.
 	 */
 	APP_EVT_ERROR
 };
 
+/** @brief Power states owned by the application module, announced in
+ *	   @ref app_module_event_type APP_EVT_POWER_STATE.
+ */
+enum app_power_state {
+	/** A host is connected and the wheels are moving. */
+	APP_POWER_ACTIVE,
+	/** A host is connected but the wheels have been still for a while. */
+	APP_POWER_CONNECTED_IDLE,
+	/** No host is connected, but the wheels are moving. */
+	APP_POWER_DISCONNECTED,
+	/** No host is connected and the wheels have been still for a while. */
+	APP_POWER_IDLE,
+
+	APP_POWER_STATE_COUNT,
+};
+
 /** @brief Data types that the application module requests samples for in
  *	   @ref app_module_event_type APP_EVT_DATA_GET.
  */
@@ -98,6 +119,8 @@ struct app_module_event {
 		int err;
 		/* Module ID, used when acknowledging shutdown requests. */
 		uint32_t id;
+		/** New power state, used by APP_EVT_POWER_STATE. */
+		enum app_power_state power_state;
 	} data;
 
 	size_t count;
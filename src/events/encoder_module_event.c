@@ -20,6 +20,8 @@ static char *get_evt_type_str(enum encoder_module_event_type type)
 		return "ENCODER_EVT_DATA_READY";
 	case ENCODER_EVT_SHUTDOWN_READY:
 		return "ENCODER_EVT_SHUTDOWN_READY";
+	case ENCODER_EVT_DEADLINE_MISSED:
+		return "ENCODER_EVT_DEADLINE_MISSED";
 	case ENCODER_EVT_ERROR:
 		return "ENCODER_EVT_ERROR";
 	default:
@@ -35,9 +37,15 @@ static void log_event(const struct app_event_header *aeh)
 		APP_EVENT_MANAGER_LOG(aeh, "%s - Error code %d",
 				get_evt_type_str(event->type), event->data.err);
 	} else if (event->type == ENCODER_EVT_DATA_READY) {
-		APP_EVENT_MANAGER_LOG(aeh, "%s - (ENCODER_A, ENCODER_B)[deg/s] = (%f, %f)",
-			get_evt_type_str(event->type), event->rot_speed_a, 
-			event->rot_speed_b);
+		const struct encoder_sample *last = &event->samples[event->sample_count - 1];
+
+		APP_EVENT_MANAGER_LOG(aeh, "%s - %u samples, last (ENCODER_A, ENCODER_B)[deg/s] = (%f, %f)",
+			get_evt_type_str(event->type), event->sample_count,
+			last->rot_speed_a, last->rot_speed_b);
+	} else if (event->type == ENCODER_EVT_DEADLINE_MISSED) {
+		APP_EVENT_MANAGER_LOG(aeh, "%s - %u missed, worst lateness %u us",
+			get_evt_type_str(event->type), event->data.deadline.missed,
+			event->data.deadline.worst_lateness_us);
 	}
 	else {
 		APP_EVENT_MANAGER_LOG(aeh, "%s", get_evt_type_str(event->type));
@@ -40,12 +40,42 @@ enum encoder_module_event_type {
 	 */
 	ENCODER_EVT_SHUTDOWN_READY,
 
+	/** Sampling periods were missed since the previous warning. The counts
+	 *  are attached in the `data.deadline` member.
+	 */
+	ENCODER_EVT_DEADLINE_MISSED,
+
 	/** An irrecoverable error has occurred in the data module. Error details are
 	 *  attached in the event structure.
 	 */
 	ENCODER_EVT_ERROR
 };
 
+#if defined(CONFIG_ENCODER_BATCH_SIZE)
+#define ENCODER_BATCH_SIZE CONFIG_ENCODER_BATCH_SIZE
+#else
+#define ENCODER_BATCH_SIZE 1
+#endif
+
+/** @brief One sample of both encoders. */
+struct encoder_sample {
+	/** Filtered rotational speeds [deg/s]. */
+	float rot_speed_a;
+	float rot_speed_b;
+	/** Encoder ticks counted during this sample, unfiltered. */
+	int32_t ticks_a;
+	int32_t ticks_b;
+	/** Uptime when the sample was captured [ms]. */
+	uint32_t timestamp_ms;
+#if IS_ENABLED(CONFIG_LATENCY_HIST)
+	/** Cycle counts of the sample fetch and of the first encoder edge in
+	 *  the sample, 0 if there was none.
+	 */
+	uint32_t fetch_cycles;
+	uint32_t edge_cycles;
+#endif
+};
+
 /** @brief Data module event. */
 struct encoder_module_event {
 	/** Data module application event header. */
@@ -53,13 +83,25 @@ struct encoder_module_event {
 	/** Data module event type. */
 	enum encoder_module_event_type type;
 
-	float rot_speed_a;
-	float rot_speed_b;
+	/** Number of valid entries in samples, oldest first. */
+	uint8_t sample_count;
+	struct encoder_sample samples[ENCODER_BATCH_SIZE];
+#if IS_ENABLED(CONFIG_LATENCY_HIST)
+	/** Cycle count when the event was submitted. */
+	uint32_t submit_cycles;
+#endif
 	union {
 		/** Module ID, used when acknowledging shutdown requests. */
 		uint32_t id;
 		/** Code signifying the cause of error. */
 		int err;
+		/** Missed sampling deadlines, used by ENCODER_EVT_DEADLINE_MISSED. */
+		struct {
+			/* Periods missed since boot, skipped, overrun or late. */
+			uint32_t missed;
+			/* Worst lateness of the sampling work since boot [us]. */
+			uint32_t worst_lateness_us;
+		} deadline;
 	} data;
 };
 
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/reboot.h>
+#include <app_event_manager.h>
+
+#include "event_pool.h"
+#include "encoder_module_event.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(event_pool, CONFIG_EVENT_POOL_LOG_LEVEL);
+
+#define BLOCK_SIZE ROUND_UP(CONFIG_EVENT_POOL_BLOCK_SIZE, sizeof(void *))
+
+/* The encoder event is submitted every sampling period. It has a slab of its
+ * own, sized for the configured batch, and never falls back to the heap.
+ */
+#define ENCODER_EVENT_SIZE sizeof(struct encoder_module_event)
+
+K_MEM_SLAB_DEFINE_STATIC(event_slab, BLOCK_SIZE, CONFIG_EVENT_POOL_BLOCK_COUNT, sizeof(void *));
+K_MEM_SLAB_DEFINE_STATIC(encoder_slab, ROUND_UP(ENCODER_EVENT_SIZE, sizeof(void *)),
+			 CONFIG_EVENT_POOL_ENCODER_BLOCK_COUNT, sizeof(void *));
+
+static struct event_pool_stats stats;
+static struct k_spinlock stats_lock;
+
+static bool is_slab_block(const struct k_mem_slab *slab, const void *addr)
+{
+	const char *start = slab->buffer;
+	const char *end = start + (size_t)slab->num_blocks * slab->block_size;
+
+	return ((const char *)addr >= start) && ((const char *)addr < end);
+}
+
+/* Encoder event block taken by event_pool_new_encoder_event, and the thread
+ * that takes it. The allocator only gets the size of an event, so this tells
+ * the encoder event apart from other events of the same size.
+ */
+static void *claimed_block;
+static k_tid_t claimed_by;
+
+static void *heap_alloc(size_t size)
+{
+	void *event = k_malloc(size);
+
+	if (unlikely(!event)) {
+		LOG_ERR("Application Event Manager OOM error");
+		__ASSERT_NO_MSG(false);
+		sys_reboot(SYS_REBOOT_WARM);
+		return NULL;
+	}
+	return event;
+}
+
+/* Overrides the heap allocator of the Application Event Manager. */
+void *app_event_manager_alloc(size_t size)
+{
+	void *event;
+	k_spinlock_key_t key;
+
+	/* Only the claiming thread writes the claim, and reads it back here. */
+	if (claimed_block && !k_is_in_isr() && (claimed_by == k_current_get()) &&
+	    (size == ENCODER_EVENT_SIZE)) {
+		event = claimed_block;
+		claimed_block = NULL;
+		claimed_by = NULL;
+		return event;
+	}
+
+	if (size > BLOCK_SIZE) {
+		key = k_spin_lock(&stats_lock);
+		stats.oversized++;
+		k_spin_unlock(&stats_lock, key);
+		return heap_alloc(size);
+	}
+
+	if (k_mem_slab_alloc(&event_slab, &event, K_NO_WAIT)) {
+		key = k_spin_lock(&stats_lock);
+		stats.exhausted++;
+		k_spin_unlock(&stats_lock, key);
+		LOG_WRN("Event pool exhausted, using the heap");
+		return heap_alloc(size);
+	}
+
+	key = k_spin_lock(&stats_lock);
+	stats.used_max = MAX(stats.used_max, k_mem_slab_num_used_get(&event_slab));
+	k_spin_unlock(&stats_lock, key);
+
+	return event;
+}
+
+void app_event_manager_free(void *addr)
+{
+	if (is_slab_block(&encoder_slab, addr)) {
+		k_mem_slab_free(&encoder_slab, &addr);
+	} else if (is_slab_block(&event_slab, addr)) {
+		k_mem_slab_free(&event_slab, &addr);
+	} else {
+		k_free(addr);
+	}
+}
+
+struct encoder_module_event *event_pool_new_encoder_event(void)
+{
+	struct encoder_module_event *event;
+	void *block;
+	k_spinlock_key_t key;
+
+	if (k_mem_slab_alloc(&encoder_slab, &block, K_NO_WAIT)) {
+		key = k_spin_lock(&stats_lock);
+		stats.encoder_dropped++;
+		k_spin_unlock(&stats_lock, key);
+		return NULL;
+	}
+
+	key = k_spin_lock(&stats_lock);
+	stats.encoder_used_max = MAX(stats.encoder_used_max,
+				     k_mem_slab_num_used_get(&encoder_slab));
+	k_spin_unlock(&stats_lock, key);
+
+	__ASSERT_NO_MSG(!k_is_in_isr() && !claimed_block);
+	claimed_by = k_current_get();
+	claimed_block = block;
+
+	event = new_encoder_module_event();
+	__ASSERT_NO_MSG((void *)event == block);
+	return event;
+}
+
+void event_pool_stats_get(struct event_pool_stats *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	*out = stats;
+	k_spin_unlock(&stats_lock, key);
+}
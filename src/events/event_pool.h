@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _EVENT_POOL_H_
+#define _EVENT_POOL_H_
+
+/**
+ * @brief Static pool for application events
+ * @defgroup event_pool Event pool
+ * @{
+ *
+ * Replaces the heap allocation of the Application Event Manager. The
+ * encoder events submitted every sampling period are allocated with
+ * event_pool_new_encoder_event() from a memory slab of their own and never
+ * come from the heap; the encoder module drops a batch when the slab is
+ * exhausted. Other events up to
+ * CONFIG_EVENT_POOL_BLOCK_SIZE bytes are taken from a second slab. Larger
+ * events, and small ones while that slab is exhausted, still come from the
+ * heap and are counted.
+ */
+
+#include <zephyr/kernel.h>
+
+#include "encoder_module_event.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Statistics of the event pool. */
+struct event_pool_stats {
+	/* Highest number of pool blocks in use at once. */
+	uint32_t used_max;
+	/* Events that fit a block but were allocated from the heap because
+	 * the pool was exhausted.
+	 */
+	uint32_t exhausted;
+	/* Events too large for a block, allocated from the heap. */
+	uint32_t oversized;
+	/* Highest number of encoder event blocks in use at once. */
+	uint32_t encoder_used_max;
+	/* Encoder events not submitted because no block was free. */
+	uint32_t encoder_dropped;
+};
+
+#if IS_ENABLED(CONFIG_EVENT_POOL)
+
+/** @brief Get statistics of the event pool.
+ *
+ *  @param[out] stats Statistics.
+ */
+void event_pool_stats_get(struct event_pool_stats *stats);
+
+/** @brief Allocate an encoder event from its own slab.
+ *
+ *  Use instead of new_encoder_module_event(). Must not be called from an
+ *  interrupt.
+ *
+ *  @return New event, or NULL if no block is free. The failure is counted
+ *          as a dropped event.
+ */
+struct encoder_module_event *event_pool_new_encoder_event(void);
+
+#else
+
+static inline void event_pool_stats_get(struct event_pool_stats *stats) {}
+static inline struct encoder_module_event *event_pool_new_encoder_event(void)
+{
+	return new_encoder_module_event();
+}
+
+#endif /* IS_ENABLED(CONFIG_EVENT_POOL) */
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* _EVENT_POOL_H_ */
@@ -6,6 +6,7 @@
 
 #include <app_event_manager.h>
 #include <zephyr/logging/log.h>
+#include "boot_trace.h"
 
 #define MODULE main
 #include <caf/events/module_state_event.h>
@@ -14,6 +15,7 @@ LOG_MODULE_REGISTER(MODULE);
 
 void main(void)
 {
+	boot_trace_mark("main");
 	if (app_event_manager_init()) {
 		LOG_ERR("Application Event Manager not initialized");
 	} else {
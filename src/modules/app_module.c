@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+
+#include <zephyr/kernel.h>
+
+#define MODULE app_module
+#include <caf/events/module_state_event.h>
+#include <caf/events/ble_common_event.h>
+#include <app_event_manager.h>
+#include "events/app_module_event.h"
+#include "events/encoder_module_event.h"
+#include "app_module.h"
+#include "hid_usb.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(MODULE, CONFIG_APPLICATION_MODULE_LOG_LEVEL);
+
+/* Power state is derived from two inputs: whether a host is connected,
+ * and whether the wheels moved within the idle timeout. All state is only
+ * accessed from the system work queue, which runs the event handlers too.
+ */
+static bool wheels_active = true;
+static uint8_t peer_count;
+static enum app_power_state power_state = APP_POWER_DISCONNECTED;
+static uint32_t last_activity_ms;
+
+static uint32_t state_time_ms[APP_POWER_STATE_COUNT];
+static uint32_t state_entered_ms;
+
+static void idle_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(idle_work, idle_work_handler);
+
+static void usb_state_work_handler(struct k_work *work);
+static K_WORK_DEFINE(usb_state_work, usb_state_work_handler);
+
+static void submit_app_event(enum app_module_event_type type)
+{
+	struct app_module_event *event = new_app_module_event();
+
+	event->type = type;
+	event->data.power_state = power_state;
+	APP_EVENT_SUBMIT(event);
+}
+
+static bool host_connected(void)
+{
+	return (peer_count > 0) || hid_usb_is_active();
+}
+
+/**
+ * @brief Recomputes the power state, and broadcasts it if it changed
+ */
+static void update_power_state(void)
+{
+	enum app_power_state new_state;
+
+	if (host_connected())
+	{
+		new_state = wheels_active ? APP_POWER_ACTIVE : APP_POWER_CONNECTED_IDLE;
+	} else {
+		new_state = wheels_active ? APP_POWER_DISCONNECTED : APP_POWER_IDLE;
+	}
+
+	if (new_state == power_state)
+	{
+		return;
+	}
+
+	uint32_t now = k_uptime_get_32();
+
+	state_time_ms[power_state] += now - state_entered_ms;
+	LOG_DBG("Power state %d -> %d after %u ms", power_state, new_state,
+		now - state_entered_ms);
+	state_entered_ms = now;
+	power_state = new_state;
+	submit_app_event(APP_EVT_POWER_STATE);
+}
+
+static void set_wheels_active(bool active)
+{
+	if (active == wheels_active)
+	{
+		return;
+	}
+	wheels_active = active;
+	submit_app_event(active ? APP_EVT_ACTIVITY_DETECTION_DISABLE :
+				  APP_EVT_ACTIVITY_DETECTION_ENABLE);
+	update_power_state();
+}
+
+static void idle_work_handler(struct k_work *work)
+{
+	uint32_t still_ms = k_uptime_get_32() - last_activity_ms;
+
+	if (still_ms < CONFIG_APP_MODULE_IDLE_TIMEOUT_MSEC)
+	{
+		k_work_reschedule(&idle_work,
+				  K_MSEC(CONFIG_APP_MODULE_IDLE_TIMEOUT_MSEC - still_ms));
+		return;
+	}
+	set_wheels_active(false);
+}
+
+static void usb_state_work_handler(struct k_work *work)
+{
+	update_power_state();
+}
+
+/**
+ * @brief Called by the USB stack when the host configures or drops the device
+ */
+static void usb_state_changed(bool active)
+{
+	k_work_submit(&usb_state_work);
+}
+
+/**
+ * @brief Registers wheel movement in an encoder event
+ */
+static void handle_encoder_event(const struct encoder_module_event *event)
+{
+	bool moved = false;
+
+	for (int i = 0; i < event->sample_count; i++)
+	{
+		if (event->samples[i].ticks_a || event->samples[i].ticks_b)
+		{
+			moved = true;
+			break;
+		}
+	}
+
+	if (!moved)
+	{
+		return;
+	}
+
+	last_activity_ms = k_uptime_get_32();
+	if (!wheels_active)
+	{
+		set_wheels_active(true);
+		k_work_reschedule(&idle_work, K_MSEC(CONFIG_APP_MODULE_IDLE_TIMEOUT_MSEC));
+	}
+}
+
+void app_module_power_stats_get(uint32_t time_ms[APP_POWER_STATE_COUNT])
+{
+	for (int i = 0; i < APP_POWER_STATE_COUNT; i++)
+	{
+		time_ms[i] = state_time_ms[i];
+	}
+	time_ms[power_state] += k_uptime_get_32() - state_entered_ms;
+}
+
+/**
+ * @brief Main event handler for module
+ *
+ * @param aeh one of the subscribed events
+ * @return true the event is consumed
+ * @return false the event is not consumed (default)
+ */
+static bool app_event_handler(const struct app_event_header *aeh)
+{
+	if (is_encoder_module_event(aeh))
+	{
+		handle_encoder_event(cast_encoder_module_event(aeh));
+		return false;
+	}
+
+	if (is_ble_peer_event(aeh))
+	{
+		const struct ble_peer_event *event = cast_ble_peer_event(aeh);
+
+		if (event->state == PEER_STATE_CONNECTED)
+		{
+			peer_count++;
+		} else if (event->state == PEER_STATE_DISCONNECTED) {
+			__ASSERT_NO_MSG(peer_count > 0);
+			peer_count--;
+		} else {
+			return false;
+		}
+		update_power_state();
+		return false;
+	}
+
+	if (is_module_state_event(aeh)) {
+		const struct module_state_event *event = cast_module_state_event(aeh);
+
+		if (check_state(event, MODULE_ID(main), MODULE_STATE_READY)) {
+			state_entered_ms = k_uptime_get_32();
+			last_activity_ms = state_entered_ms;
+			k_work_reschedule(&idle_work, K_MSEC(CONFIG_APP_MODULE_IDLE_TIMEOUT_MSEC));
+			submit_app_event(APP_EVT_POWER_STATE);
+			hid_usb_set_state_cb(usb_state_changed);
+			/* The host may have configured USB before the handler was set. */
+			update_power_state();
+			module_set_state(MODULE_STATE_READY);
+		}
+		return false;
+	}
+
+	/* Event not handled but subscribed. */
+	__ASSERT_NO_MSG(false);
+	return false;
+}
+
+APP_EVENT_LISTENER(MODULE, app_event_handler);
+APP_EVENT_SUBSCRIBE(MODULE, module_state_event);
+APP_EVENT_SUBSCRIBE(MODULE, ble_peer_event);
+APP_EVENT_SUBSCRIBE(MODULE, encoder_module_event);
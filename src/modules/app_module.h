@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _APP_MODULE_H_
+#define _APP_MODULE_H_
+
+/**@file
+ *@brief Power state statistics of the application module.
+ */
+
+#include <zephyr/types.h>
+#include "events/app_module_event.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Get the time spent in each power state since boot.
+ *
+ *  Must be called from the system work queue, like the application event
+ *  handlers.
+ *
+ *  @param[out] time_ms Milliseconds spent in each state, indexed by
+ *		@ref app_power_state.
+ */
+void app_module_power_stats_get(uint32_t time_ms[APP_POWER_STATE_COUNT]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _APP_MODULE_H_ */
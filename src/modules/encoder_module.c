@@ -7,14 +7,22 @@
 
 #include <zephyr/kernel.h>
 #include <float.h>
+#include <string.h>
 
 #define MODULE encoder_module
 #include <caf/events/module_state_event.h>
 #include <app_event_manager.h>
 #include <zephyr/settings/settings.h>
 #include <drivers/sensor.h>
+#include "qdec_gpio.h"
 #include "modules_common.h"
+#include "encoder_params.h"
+#include "param_store.h"
+#include "boot_trace.h"
+#include "latency_hist.h"
+#include "events/event_pool.h"
 #include "events/encoder_module_event.h"
+#include "events/app_module_event.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(MODULE, CONFIG_ENCODER_MODULE_LOG_LEVEL);
@@ -31,10 +39,22 @@ struct device* encoder_b_dev;
 static float encoder_a_rot_speed = 0.0;
 static float encoder_b_rot_speed = 0.0;
 static float cumulative_encoder_b = 0.0;
+static int32_t encoder_a_ticks;
+static int32_t encoder_b_ticks;
+static uint32_t sample_timestamp_ms;
+#if IS_ENABLED(CONFIG_LATENCY_HIST)
+static uint32_t sample_fetch_cycles;
+static uint32_t sample_edge_cycles;
+#endif
+
+/* Samples collected for the next event. */
+static struct encoder_sample batch[CONFIG_ENCODER_BATCH_SIZE];
+static uint8_t batch_count;
 
-#define DT_MSEC CONFIG_ENCODER_DELTA_TIME_MSEC
-static const float alpha = ((float)CONFIG_ENCODER_MOVING_AVERAGE_ALPHA)/1000.0;
-static const float dt = (float)DT_MSEC/1000.0;
+static struct encoder_params params = ENCODER_PARAMS_DEFAULT;
+static uint32_t params_generation;
+static float alpha = ((float)CONFIG_ENCODER_MOVING_AVERAGE_ALPHA)/1000.0;
+static float dt = (float)CONFIG_ENCODER_DELTA_TIME_MSEC/1000.0;
 
 
 #if CONFIG_ENCODER_SIMULATE_INPUT
@@ -43,19 +63,70 @@ static const float dt = (float)DT_MSEC/1000.0;
 #define  MAX_SIMULATED_ENCODER_TICKS 0
 #endif
 
+#define TICKS_PER_ROTATION DT_PROP(DT_NODELABEL(qdeca), ticks_per_rotation)
+
 static float simulated_encoder_value = 1000000.0;
 static int simulated_encoder_ticks = 0;
 
+static bool first_batch_sent;
+
 /**
- * @brief Sends the encoder values from the encoder module to other listening modules
+ * @brief Sends the collected samples to other listening modules
  */
-static void send_data_evt(void)
+static void submit_batch(void)
 {
-	struct encoder_module_event *encoder_module_event = new_encoder_module_event();
+	struct encoder_module_event *encoder_module_event = event_pool_new_encoder_event();
+
+	if (!encoder_module_event)
+	{
+		/* The consumers are behind, newer samples are worth more. */
+		LOG_DBG("No free encoder event, %u samples dropped", batch_count);
+		batch_count = 0;
+		return;
+	}
+
 	encoder_module_event->type = ENCODER_EVT_DATA_READY;
-	encoder_module_event->rot_speed_a = encoder_a_rot_speed;
-	encoder_module_event->rot_speed_b = encoder_b_rot_speed;
+	encoder_module_event->sample_count = batch_count;
+	memcpy(encoder_module_event->samples, batch, batch_count * sizeof(batch[0]));
+#if IS_ENABLED(CONFIG_LATENCY_HIST)
+	for (int i = 0; i < batch_count; i++)
+	{
+		latency_hist_add(LATENCY_FETCH_TO_SUBMIT, batch[i].fetch_cycles);
+	}
+	encoder_module_event->submit_cycles = latency_stamp();
+#endif
 	APP_EVENT_SUBMIT(encoder_module_event);
+	batch_count = 0;
+
+	if (IS_ENABLED(CONFIG_BOOT_TRACE) && !first_batch_sent)
+	{
+		first_batch_sent = true;
+		boot_trace_mark("first sample");
+	}
+}
+
+/**
+ * @brief Adds the encoder values to the batch, and sends the batch to other
+ *        listening modules once it holds CONFIG_ENCODER_BATCH_SIZE samples
+ */
+static void send_data_evt(void)
+{
+	struct encoder_sample *sample = &batch[batch_count++];
+
+	sample->rot_speed_a = encoder_a_rot_speed;
+	sample->rot_speed_b = encoder_b_rot_speed;
+	sample->ticks_a = encoder_a_ticks;
+	sample->ticks_b = encoder_b_ticks;
+	sample->timestamp_ms = sample_timestamp_ms;
+#if IS_ENABLED(CONFIG_LATENCY_HIST)
+	sample->fetch_cycles = sample_fetch_cycles;
+	sample->edge_cycles = sample_edge_cycles;
+#endif
+	if (batch_count < CONFIG_ENCODER_BATCH_SIZE)
+	{
+		return;
+	}
+	submit_batch();
 }
 
 /**
@@ -72,16 +143,179 @@ static float moving_avg_filter(float y_prev, float x)
 }
 
 
+/* Set while the application module reports the wheels as still. Sampling
+ * is then paused until an encoder tick arrives. Simulated input never ticks,
+ * it only resumes when the application module reports activity again.
+ */
+static bool detect_activity;
+static bool sampling_paused;
+
+static void sampling_pause(void);
+
 static void data_evt_timeout_work_handler(struct k_work *work);
 K_WORK_DEFINE(data_evt_timeout_work, data_evt_timeout_work_handler);
 
+#if IS_ENABLED(CONFIG_ENCODER_DEADLINE_MONITOR)
+/* Written by the timer handler. The sampling work reads a copy taken with
+ * interrupts locked, so the counters and the cycle count are consistent.
+ */
+struct deadline_timer_stats {
+	/* Timer expirations. */
+	uint32_t periods;
+	/* Expirations while the work was still queued, merged into it. */
+	uint32_t skipped;
+	/* Expirations while the work was running. */
+	uint32_t overruns;
+	/* Cycle count of the expiration the queued work is serving. */
+	uint32_t fired_cycles;
+};
+
+static struct deadline_timer_stats deadline_timer;
+
+/* Only accessed from the sampling work. */
+static struct {
+	/* Work started more than CONFIG_ENCODER_DEADLINE_LATE_US late. */
+	uint32_t late;
+	uint32_t worst_lateness_us;
+	uint32_t missed_reported;
+	uint32_t warning_time_ms;
+} deadline_work;
+
+/**
+ * @brief Measures how late the sampling work started, and warns other
+ *        modules about missed deadlines at most once per interval
+ */
+static void deadline_check(void)
+{
+	uint32_t now_cycles = k_cycle_get_32();
+	struct deadline_timer_stats timer;
+	unsigned int key = irq_lock();
+
+	timer = deadline_timer;
+	irq_unlock(key);
+
+	uint32_t lateness_us = k_cyc_to_us_floor32(now_cycles - timer.fired_cycles);
+	uint32_t missed;
+
+	if (lateness_us > deadline_work.worst_lateness_us)
+	{
+		deadline_work.worst_lateness_us = lateness_us;
+	}
+	if (lateness_us > CONFIG_ENCODER_DEADLINE_LATE_US)
+	{
+		deadline_work.late++;
+	}
+
+	missed = timer.skipped + timer.overruns + deadline_work.late;
+	if (missed == deadline_work.missed_reported)
+	{
+		return;
+	}
+
+	uint32_t now = k_uptime_get_32();
+
+	if (deadline_work.missed_reported &&
+	    (now - deadline_work.warning_time_ms < CONFIG_ENCODER_DEADLINE_WARNING_INTERVAL_MS))
+	{
+		return;
+	}
+	deadline_work.warning_time_ms = now;
+
+#if IS_ENABLED(CONFIG_ENCODER_DEADLINE_EVENT)
+	struct encoder_module_event *event = event_pool_new_encoder_event();
+
+	if (event)
+	{
+		event->type = ENCODER_EVT_DEADLINE_MISSED;
+		event->sample_count = 0;
+		event->data.deadline.missed = missed;
+		event->data.deadline.worst_lateness_us = deadline_work.worst_lateness_us;
+		APP_EVENT_SUBMIT(event);
+	}
+#endif
+	LOG_WRN("Sampling deadlines missed: %u skipped, %u overrun, %u late of %u, worst %u us",
+		timer.skipped, timer.overruns, deadline_work.late,
+		timer.periods, deadline_work.worst_lateness_us);
+	deadline_work.missed_reported = missed;
+}
+#else
+static void deadline_check(void) {}
+#endif /* CONFIG_ENCODER_DEADLINE_MONITOR */
+
 void data_evt_timeout_handler(struct k_timer *dummy)
 {
-    k_work_submit(&data_evt_timeout_work);
+	int ret = k_work_submit(&data_evt_timeout_work);
+
+#if IS_ENABLED(CONFIG_ENCODER_DEADLINE_MONITOR)
+	deadline_timer.periods++;
+	if (ret == 0)
+	{
+		/* Still queued, lateness counts from the earlier expiration. */
+		deadline_timer.skipped++;
+		return;
+	}
+	if (ret == 2)
+	{
+		deadline_timer.overruns++;
+	}
+	deadline_timer.fired_cycles = k_cycle_get_32();
+#else
+	ARG_UNUSED(ret);
+#endif
 }
 
 K_TIMER_DEFINE(data_evt_timeout, data_evt_timeout_handler, NULL);
 
+/**
+ * @brief Applies encoder parameters from the parameter store, if any are stored
+ * 
+ * @return true if the sampling interval changed
+ */
+static bool load_params(void)
+{
+	struct encoder_params stored;
+	uint16_t prev_delta_time_msec = params.delta_time_msec;
+
+	params_generation = param_store_generation(PARAM_STORE_ENCODER);
+	if (param_store_get(PARAM_STORE_ENCODER, &stored, sizeof(stored)) ||
+	    !encoder_params_valid(&stored))
+	{
+		return false;
+	}
+
+	params = stored;
+	alpha = ((float)params.moving_average_alpha_permille)/1000.0;
+	dt = (float)params.delta_time_msec/1000.0;
+	LOG_INF("Encoder parameters: alpha %d permille, dt %d ms",
+		params.moving_average_alpha_permille, params.delta_time_msec);
+	return params.delta_time_msec != prev_delta_time_msec;
+}
+
+#if IS_ENABLED(CONFIG_LATENCY_HIST)
+/**
+ * @brief Adds the time from the first edge of the fetched sample to now, and
+ *        keeps the earliest edge of both encoders for the total latency
+ */
+static void stamp_edge(const struct device *dev)
+{
+	struct sensor_value edge;
+
+	if (!IS_ENABLED(CONFIG_QDEC_GPIO_EDGE_TIMESTAMP) ||
+	    sensor_channel_get(dev, (enum sensor_channel)QDEC_GPIO_CHAN_EDGE_CYCLES, &edge) ||
+	    !edge.val2)
+	{
+		return;
+	}
+	latency_hist_add(LATENCY_EDGE_TO_FETCH, (uint32_t)edge.val1);
+	if (!sample_edge_cycles || ((int32_t)((uint32_t)edge.val1 - sample_edge_cycles) < 0))
+	{
+		sample_edge_cycles = (uint32_t)edge.val1;
+	}
+}
+#else
+static void stamp_edge(const struct device *dev) {}
+#endif
+
 /**
  * @brief Functions that run upon the expiration of each sampling interval
  * 
@@ -89,6 +323,22 @@ K_TIMER_DEFINE(data_evt_timeout, data_evt_timeout_handler, NULL);
  */
 void data_evt_timeout_work_handler(struct k_work *work)
 {
+	deadline_check();
+
+	if (IS_ENABLED(CONFIG_PARAM_STORE) &&
+	    (param_store_generation(PARAM_STORE_ENCODER) != params_generation) &&
+	    load_params())
+	{
+		k_timer_start(&data_evt_timeout, K_MSEC(params.delta_time_msec),
+			      K_MSEC(params.delta_time_msec));
+	}
+
+	sample_timestamp_ms = k_uptime_get_32();
+#if IS_ENABLED(CONFIG_LATENCY_HIST)
+	sample_fetch_cycles = latency_stamp();
+	sample_edge_cycles = 0;
+#endif
+
 	if (IS_ENABLED(CONFIG_ENCODER_SIMULATE_INPUT))
 	{
 		float encoder_a_current_speed = simulated_encoder_value/dt;
@@ -96,6 +346,9 @@ void data_evt_timeout_work_handler(struct k_work *work)
 
 		float encoder_b_current_speed = simulated_encoder_value/dt;
 		encoder_b_rot_speed = moving_avg_filter(encoder_b_rot_speed, encoder_b_current_speed);
+
+		encoder_a_ticks = (int32_t)(simulated_encoder_value * TICKS_PER_ROTATION / 360.0f);
+		encoder_b_ticks = encoder_a_ticks;
 		send_data_evt();
 
 		simulated_encoder_ticks++;
@@ -108,7 +361,7 @@ void data_evt_timeout_work_handler(struct k_work *work)
 	}
 
 
-	struct sensor_value rot_a, rot_b;
+	struct sensor_value rot_a, rot_b, ticks;
 	int err;
 	err = sensor_sample_fetch(encoder_a_dev);
 	if (err != 0)
@@ -123,6 +376,15 @@ void data_evt_timeout_work_handler(struct k_work *work)
 		LOG_ERR("Encoder A sensor_channel_get error: %d\n", err);
 		return;
 	}
+	err = sensor_channel_get(encoder_a_dev, (enum sensor_channel)QDEC_GPIO_CHAN_TICKS, &ticks);
+	if (err != 0)
+	{
+		LOG_ERR("Encoder A sensor_channel_get error: %d\n", err);
+		return;
+	}
+	encoder_a_ticks = ticks.val1;
+	stamp_edge(encoder_a_dev);
+
 	float encoder_a_rot_delta = (float)sensor_value_to_double(&rot_a);
 	float encoder_a_current_speed = encoder_a_rot_delta/dt;
 	encoder_a_rot_speed = moving_avg_filter(encoder_a_rot_speed, encoder_a_current_speed);
@@ -142,11 +404,91 @@ void data_evt_timeout_work_handler(struct k_work *work)
 		return;
 	}
 
+	err = sensor_channel_get(encoder_b_dev, (enum sensor_channel)QDEC_GPIO_CHAN_TICKS, &ticks);
+	if (err != 0)
+	{
+		LOG_ERR("Encoder B sensor_channel_get error: %d\n", err);
+		return;
+	}
+	encoder_b_ticks = ticks.val1;
+	stamp_edge(encoder_b_dev);
+
 	float encoder_b_rot_delta = (float)sensor_value_to_double(&rot_b);
 	float encoder_b_current_speed = encoder_b_rot_delta/dt;
 	encoder_b_rot_speed = moving_avg_filter(encoder_b_rot_speed, encoder_b_current_speed);
 	LOG_DBG("Encoder B rot speed: %f", encoder_b_rot_speed);
 	send_data_evt();
+
+	if (detect_activity && !encoder_a_ticks && !encoder_b_ticks)
+	{
+		/* Woken by a stray tick, go back to waiting. */
+		sampling_pause();
+	}
+}
+
+static void activity_work_handler(struct k_work *work);
+K_WORK_DEFINE(activity_work, activity_work_handler);
+
+static void activity_trigger_handler(const struct device *dev,
+				     const struct sensor_trigger *trig)
+{
+	k_work_submit(&activity_work);
+}
+
+/**
+ * @brief Stops periodic sampling and waits for the first encoder tick
+ *        instead, while the application module reports no activity
+ */
+static void sampling_pause(void)
+{
+	const struct sensor_trigger trig = {
+		.type = SENSOR_TRIG_DATA_READY,
+		.chan = SENSOR_CHAN_ROTATION,
+	};
+
+	if (sampling_paused)
+	{
+		return;
+	}
+	k_timer_stop(&data_evt_timeout);
+	if (batch_count)
+	{
+		submit_batch();
+	}
+	sampling_paused = true;
+	if (!IS_ENABLED(CONFIG_ENCODER_SIMULATE_INPUT))
+	{
+		sensor_trigger_set(encoder_a_dev, &trig, activity_trigger_handler);
+		sensor_trigger_set(encoder_b_dev, &trig, activity_trigger_handler);
+	}
+	LOG_DBG("Sampling paused");
+}
+
+static void sampling_resume(void)
+{
+	const struct sensor_trigger trig = {
+		.type = SENSOR_TRIG_DATA_READY,
+		.chan = SENSOR_CHAN_ROTATION,
+	};
+
+	if (!sampling_paused)
+	{
+		return;
+	}
+	if (!IS_ENABLED(CONFIG_ENCODER_SIMULATE_INPUT))
+	{
+		sensor_trigger_set(encoder_a_dev, &trig, NULL);
+		sensor_trigger_set(encoder_b_dev, &trig, NULL);
+	}
+	sampling_paused = false;
+	k_timer_start(&data_evt_timeout, K_MSEC(params.delta_time_msec),
+		      K_MSEC(params.delta_time_msec));
+	LOG_DBG("Sampling resumed");
+}
+
+static void activity_work_handler(struct k_work *work)
+{
+	sampling_resume();
 }
 
 static int module_init(void)
@@ -164,7 +506,10 @@ static int module_init(void)
 		LOG_DBG("Using simulated encoder inputs");
 	}
 
-	k_timer_start(&data_evt_timeout, K_NO_WAIT, K_MSEC(DT_MSEC));
+	/* Sampling starts with the defaults, stored parameters are applied
+	 * by the work handler once the parameter store is loaded.
+	 */
+	k_timer_start(&data_evt_timeout, K_NO_WAIT, K_MSEC(params.delta_time_msec));
 	return 0;
 }
 
@@ -184,13 +529,33 @@ static bool app_event_handler(const struct app_event_header *aeh)
             LOG_INF("ENCODER module initialized");
             module_set_state(MODULE_STATE_READY);
 		}
+#if IS_ENABLED(CONFIG_PARAM_STORE)
+		if (check_state(event, MODULE_ID(settings_loader), MODULE_STATE_READY)) {
+			param_store_load();
+		}
+#endif
 
 		return false;
 	}
+
+	if (is_app_module_event(aeh)) {
+		const struct app_module_event *event = cast_app_module_event(aeh);
+
+		if (event->type == APP_EVT_ACTIVITY_DETECTION_ENABLE) {
+			detect_activity = true;
+			sampling_pause();
+		} else if (event->type == APP_EVT_ACTIVITY_DETECTION_DISABLE) {
+			detect_activity = false;
+			sampling_resume();
+		}
+		return false;
+	}
+
 	/* Event not handled but subscribed. */
 	__ASSERT_NO_MSG(false);
 	return false;
 }
 
 APP_EVENT_LISTENER(MODULE, app_event_handler);
-APP_EVENT_SUBSCRIBE(MODULE, module_state_event);
\ No newline at end of file
+APP_EVENT_SUBSCRIBE(MODULE, module_state_event);
+APP_EVENT_SUBSCRIBE(MODULE, app_module_event);
\ No newline at end of file
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _ENCODER_PARAMS_H_
+#define _ENCODER_PARAMS_H_
+
+/**@file
+ *@brief Runtime-tunable parameters of the encoder module.
+ */
+
+#include <zephyr/types.h>
+#include <zephyr/toolchain.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Encoder module parameters, kept in the parameter store.
+ *
+ *  This is also the layout of the encoder feature report (see
+ *  hid_report_desc.c), with all fields in little endian.
+ */
+struct encoder_params {
+	/* Alpha for the moving average filter [permille]. */
+	uint16_t moving_average_alpha_permille;
+	/* Sampling interval [ms]. */
+	uint16_t delta_time_msec;
+} __packed;
+
+/** @brief Encoder parameters used when nothing is stored. */
+#define ENCODER_PARAMS_DEFAULT {						\
+	.moving_average_alpha_permille = CONFIG_ENCODER_MOVING_AVERAGE_ALPHA,	\
+	.delta_time_msec = CONFIG_ENCODER_DELTA_TIME_MSEC,			\
+}
+
+/** @brief Check that encoder parameters are usable.
+ *
+ *  @param[in] params Encoder parameters.
+ *
+ *  @return true if valid.
+ */
+static inline bool encoder_params_valid(const struct encoder_params *params)
+{
+	return (params->moving_average_alpha_permille < 1000) &&
+	       (params->delta_time_msec > 0);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ENCODER_PARAMS_H_ */
@@ -12,12 +12,23 @@
 #include <zephyr/types.h>
 
 #include <zephyr/sys/util.h>
+#include <zephyr/sys/byteorder.h>
 
+#include <zephyr/bluetooth/conn.h>
 #include <bluetooth/services/hids.h>
 
 #include <caf/events/ble_common_event.h>
+#include <caf/events/button_event.h>
 #include "hid_report_desc.h"
 #include "events/encoder_module_event.h"
+#include "events/app_module_event.h"
+#include "hid_usb.h"
+#include "hid_profile.h"
+#include "encoder_params.h"
+#include "param_store.h"
+#include "telemetry.h"
+#include "boot_trace.h"
+#include "latency_hist.h"
 
 #define MODULE hid_module
 #include <caf/events/module_state_event.h>
@@ -27,306 +38,996 @@ LOG_MODULE_REGISTER(MODULE, CONFIG_HID_MODULE_LOG_LEVEL);
 
 #define M_PI   3.14159265358979323846264338327950288
 
-/* Wheelchair configuration values */
+/* Profile of the most recently secured peer, or the default profile. The
+ * odometry is computed with its geometry. Only accessed from the event
+ * handler context.
+ */
+static struct hid_profile *active_profile;
+
+#define BASE_USB_HID_SPEC_VERSION 0x0101
+
+/* Report ID of the buttons and joystick (see hid_report_desc.c)*/
+#define INPUT_REP_REF_GAMEPAD_ID 1
+/* Report ID of the tuning parameters (see hid_report_desc.c)*/
+#define FEATURE_REP_REF_TUNING_ID 3
+/* Report ID of the encoder parameters (see hid_report_desc.c)*/
+#define FEATURE_REP_REF_ENCODER_ID 4
+/* Report ID of the axis mapping (see hid_report_desc.c)*/
+#define FEATURE_REP_REF_AXIS_MAP_ID 5
+/* Report ID of the odometry (see hid_report_desc.c)*/
+#define FEATURE_REP_REF_ODOMETRY_ID 6
+/* Report ID of the device clock (see hid_report_desc.c)*/
+#define FEATURE_REP_REF_CLOCK_ID 7
+/* Number of buttons in the Game Pad Input Report. */
+#define INPUT_REP_BUTTON_COUNT 16
+/* Offset of the button bitmask in the Game Pad Input Report. */
+#define INPUT_REP_BUTTONS_OFFSET 0
+/* Offset of the joystick axes in the Game Pad Input Report. */
+#define INPUT_REP_AXES_OFFSET (INPUT_REP_BUTTON_COUNT / 8)
+/* Value of a joystick axis at rest, map_axis() of a zero signal. */
+#define INPUT_REP_AXIS_NEUTRAL 128
+/* Offset of the capture timestamp in the Game Pad Input Report. */
+#define INPUT_REP_TIMESTAMP_OFFSET (INPUT_REP_AXES_OFFSET + HID_AXIS_COUNT)
+#if IS_ENABLED(CONFIG_HID_MODULE_REPORT_TIMESTAMP)
+#define INPUT_REP_TIMESTAMP_NUM_BYTES 2
+#else
+#define INPUT_REP_TIMESTAMP_NUM_BYTES 0
+#endif
+/* Length of Game Pad Input Report containing buttons and joystick data. */
+#define INPUT_REP_GAMEPAD_NUM_BYTES (INPUT_REP_TIMESTAMP_OFFSET + INPUT_REP_TIMESTAMP_NUM_BYTES)
+/* Index of Game pad Input Report containing buttons and joystick data. */
+#define INPUT_REP_GAMEPAD_INDEX 0
+/* Length of Feature Report containing tuning parameters. */
+#define FEATURE_REP_TUNING_NUM_BYTES sizeof(struct hid_tuning_params)
+/* Index of Feature Report containing tuning parameters. */
+#define FEATURE_REP_TUNING_INDEX 0
+/* Length of Feature Report containing encoder parameters. */
+#define FEATURE_REP_ENCODER_NUM_BYTES sizeof(struct encoder_params)
+/* Index of Feature Report containing encoder parameters. */
+#define FEATURE_REP_ENCODER_INDEX 1
+/* Length of Feature Report containing the axis mapping. */
+#define FEATURE_REP_AXIS_MAP_NUM_BYTES sizeof(struct hid_axis_map)
+/* Index of Feature Report containing the axis mapping. */
+#define FEATURE_REP_AXIS_MAP_INDEX 2
+/* Length of Feature Report containing the odometry. */
+#define FEATURE_REP_ODOMETRY_NUM_BYTES sizeof(struct odometry_report)
+/* Index of Feature Report containing the odometry. */
+#define FEATURE_REP_ODOMETRY_INDEX 3
+/* Length of Feature Report containing the device clock. */
+#define FEATURE_REP_CLOCK_NUM_BYTES sizeof(struct clock_report)
+/* Index of Feature Report containing the device clock. */
+#define FEATURE_REP_CLOCK_INDEX 4
 
-const float max_wheel_speed_m_per_sec = ((float)CONFIG_HID_MODULE_MAX_OUTPUT_SPEED_MM_PER_SEC) / 1000.0f;
 /**
- * @brief The radius [m] of one of the cylinders of the ergometer
+ * @brief Layout of the device clock feature report (see hid_report_desc.c),
+ *        all fields in little endian. The timestamp of the input report
+ *        holds the 16 least significant bits of uptime_ms at sample capture,
+ *        so a host can map it onto its own clock by reading this report.
  */
-const float r_c = ((float)CONFIG_APP_CYLINDER_DIAMETER_MM) / (2.0*1000.0);
+struct clock_report {
+    /* Uptime when the report was read [ms] */
+    uint32_t uptime_ms;
+} __packed;
 
 /**
- * @brief Half of the distance [m] between the wheelchair wheels.
-*/
-const float r_p = ((float)CONFIG_APP_INTER_WHEEL_DISTANCE_MM) / (2.0*1000.0);
+ * @brief Layout of the odometry feature report (see hid_report_desc.c),
+ *        all fields in little endian. Writing the report resets it.
+ */
+struct odometry_report {
+    /* Distance along the path, negative when reversing [mm] */
+    int32_t distance_mm;
+    /* Position, y straight ahead from where odometry was reset [mm] */
+    int32_t x_mm;
+    int32_t y_mm;
+    /* Heading, clockwise positive [millidegrees] */
+    int32_t heading_mdeg;
+} __packed;
+
+/* Only accessed from the event handler context. */
+static struct dead_reckoning odometry;
+/* Geometry the odometry ticks were counted with. */
+static struct dead_reckoning_geometry odometry_geometry;
+/* Latest odometry, read from the Bluetooth and USB contexts. */
+static struct odometry_report odometry_report;
+static struct k_spinlock odometry_lock;
+/* Set by a write to the odometry report, handled on the next sample. */
+static atomic_t odometry_reset_pending;
+
+/* Logging utils */
+const int readings_per_log = 1;
+static int message_counter = 0;
 
 /**
- * @brief IIR coefficient of turning sensitivity vs translational speed.
- *        y[t]=alpha*y[t-1]+(1-alpha)*x[t]
+ * @brief Payload of the HID telemetry frame (TELEMETRY_FRAME_HID), all
+ *        fields in little endian. Decoded by scripts/telemetry_decode.py.
  */
-const float sensitivity_alpha = 0.4;
+struct hid_telemetry {
+    /* Translational speed, unclamped and clamped to the max speed [m/s] */
+    float speed;
+    float speed_clamped;
+    /* Turn rate before and after the turning sensitivity [deg/s] */
+    float turn_rate;
+    float output_turn_rate;
+    /* Turning sensitivity, before and after filtering */
+    float difference_sensitivity;
+    float filtered_difference_sensitivity;
+    /* Joystick axes of the report */
+    uint8_t axes[HID_AXIS_COUNT];
+} __packed;
 
-/* Values that were tweaked for device iterations */
-/**----------------------
- *!    ROUND 1
- *------------------------**/
-// const float max_translational_speed_m_per_sec = 3.5;
-// const float min_translational_speed_m_per_sec = 0.0;
-// const float max_turn_rate_deg_per_sec = 150.0;
-// const float min_turn_rate_deg_per_sec = 0.0;
-// const float difference_sensitivity_start = 0.3;
-// const float difference_sensitivity_end = 0.65;
-/**----------------------
- *!    ROUND 2
- *------------------------**/
-// const float max_translational_speed_m_per_sec = 3.5f;
-// const float max_turn_rate_deg_per_sec = 60.0f;
-// const float difference_sensitivity_start = 0.3f;
-// const float difference_sensitivity_end = 0.65f;
+BUILD_ASSERT(sizeof(struct hid_telemetry) <= TELEMETRY_PAYLOAD_MAX_SIZE);
 
-/**----------------------
- *!    ROUND 3
- *------------------------**/
-const float max_translational_speed_m_per_sec = 3.5f;
-const float max_turn_rate_deg_per_sec = 150.0f;
-const float difference_sensitivity_start = 0.3f;
-const float difference_sensitivity_end = 0.65f;
+/* Filled while the report is built. Only accessed from the event handler context. */
+static struct hid_telemetry hid_telemetry;
 
-#define HID_TURN_SCALING (float)CONFIG_HID_MODULE_TURN_SCALING_MULTIPLIER_THOUSANDTHS/1000.0f
+/**
+ * @brief Game pad report of one host, computed with the profile of that host.
+ *        Every connected peer has its own, so that a peer connecting with
+ *        another profile does not change the output of the others.
+ *        Only accessed from the event handler context.
+ */
+struct hid_output {
+    /* Profile the axes are computed with */
+    const struct hid_profile *profile;
+    /* Turning sensitivity of the previous sample */
+    float sensitivity;
+    /* Filter state of the output stage, reset with the profile */
+    struct axis_filter_state axes[HID_AXIS_COUNT];
+#if IS_ENABLED(CONFIG_HID_MODULE_PREDICTOR)
+    struct predictor_state predictors[HID_AXIS_COUNT];
+#endif
+    /* Report being built, and the last one handed to the transport.
+     * The timestamp is left out of the comparison, as it changes with every sample.
+     */
+    uint8_t report[INPUT_REP_GAMEPAD_NUM_BYTES];
+    uint8_t last_report[INPUT_REP_TIMESTAMP_OFFSET];
+};
 
-#define BASE_USB_HID_SPEC_VERSION 0x0101
+/* Output of the USB host, always with the default profile. Also built while
+ * no peer is secured. Only accessed from the event handler context.
+ */
+static struct hid_output usb_output;
+static bool usb_was_active;
+/* Buttons of every report. Only accessed from the event handler context. */
+static uint16_t buttons;
 
-/* Report ID of the button (see hid_report_desc.c)*/
-#define INPUT_REP_REF_BUTTONS_ID 1
-/* Report ID of the joystick (see hid_report_desc.c)*/
-#define INPUT_REP_REF_JOYSTICK_ID 2
-/* Length of Game Pad Input Report containing button data. */
-#define INPUT_REP_BUTTONS_NUM_BYTES 2
-/* Length of Game Pad Input Report containing joystick data. */
-#define INPUT_REP_JOYSTICK_NUM_BYTES 4
-/* Index of Game pad Input Report containing buttons data. */
-#define INPUT_REP_BUTTON_INDEX 0
-/* Index of Game pad Input Report containing joystick data. */
-#define INPUT_REP_JOYSTICK_INDEX 1
-
-const uint8_t joystick_neutral = 128;
+/**
+ * @brief Starts an output over with a profile. The filters are reset and
+ *        all joystick axes are put at rest, so that a report sent before
+ *        the first sample does not show full deflection.
+ *
+ * @param output Output
+ * @param profile Profile the axes are computed with from now on
+ */
+static void output_init(struct hid_output *output, const struct hid_profile *profile)
+{
+    output->profile = profile;
+    output->sensitivity = HID_SENSITIVITY_MAX;
+    for (size_t i = 0; i < HID_AXIS_COUNT; i++)
+    {
+        axis_filter_reset(&output->axes[i]);
+#if IS_ENABLED(CONFIG_HID_MODULE_PREDICTOR)
+        predictor_reset(&output->predictors[i]);
+#endif
+    }
+    memset(&output->report[INPUT_REP_AXES_OFFSET], INPUT_REP_AXIS_NEUTRAL, HID_AXIS_COUNT);
+}
 
-/* Logging utils */
-const int readings_per_log = 1;
-static int message_counter = 0;
+/**
+ * @brief Number of reports over the last statistics window.
+ */
+static struct {
+    /* Notifications queued, or reports queued on USB */
+    uint32_t sent;
+    /* Samples that left the report unchanged and were not sent */
+    uint32_t unchanged;
+    int64_t window_start;
+} report_stats;
+
+#define REPORT_STATS_WINDOW_MS 1000
 
 /* HIDS instance. */
 BT_HIDS_DEF(hids_obj,
-            INPUT_REP_BUTTONS_NUM_BYTES,
-            INPUT_REP_JOYSTICK_NUM_BYTES
+            INPUT_REP_GAMEPAD_NUM_BYTES,
+            FEATURE_REP_TUNING_NUM_BYTES,
+            FEATURE_REP_ENCODER_NUM_BYTES,
+            FEATURE_REP_AXIS_MAP_NUM_BYTES,
+            FEATURE_REP_ODOMETRY_NUM_BYTES,
+            FEATURE_REP_CLOCK_NUM_BYTES
             );
 
-static struct bt_conn *cur_conn;
-static bool secured;
-static bool protocol_boot;
+/**
+ * @brief State kept for each connected HID host.
+ */
+struct hid_conn {
+    struct bt_conn *conn;
+    bool secured;
+    /* Set while a notification is queued in the stack for this peer. */
+    atomic_t in_flight;
+    /* Reports skipped because the previous one was not yet sent. */
+    uint32_t skipped;
+    /* Set when the peer has not received the last report. */
+    bool stale;
+    /* Profile of the peer, set once the link is secured. */
+    struct hid_profile *profile;
+    /* Report of the peer, built once the link is secured. */
+    struct hid_output output;
+    /* Uptime of the connection, to log the time to the first report. */
+    uint32_t connected_ms;
+    bool first_report_pending;
+#if IS_ENABLED(CONFIG_LATENCY_HIST)
+    /* Cycle counts of the report in flight and of its first encoder edge. */
+    uint32_t report_cycles;
+    uint32_t edge_cycles;
+#endif
+};
+
+static struct hid_conn hid_conns[CONFIG_BT_MAX_CONN];
+
+#if IS_ENABLED(CONFIG_LATENCY_HIST)
+/* First encoder edge of the report being sent, 0 if not from an encoder. */
+static uint32_t report_edge_cycles;
+#endif
 
 
 /**========================================================================
  *                     Encoder values to HID report
  *========================================================================**/
 
-static float clamp_f(float val, float min, float max)
-{
-    if (min > max)
-    {
-        return CLAMP(val, max, min);
-    }
-    return CLAMP(val, min, max);
-}
-
 static float degree_to_radian(float degrees)
 {
     return degrees*M_PI/180.0;
 }
 
-static float radian_to_degree(float radians)
-{
-    return radians*180.0/M_PI;
-}
-
 /**
  * @brief Physical model for turning rotational speeds of rollers into
  *        a player turn rate.
  *
+ * @param coeffs Coefficients of the profile
  * @param enc_a_rad_per_sec Angular velocity of right-hand rollers (rad/s)
  * @param enc_b_rad_per_sec Angular velocity of left-hand rollers (rad/s)
  * @return float angular velocity about upward axis of the player (clockwise=positive)
  */
-static float rot_speeds_to_turn_rate(float enc_a_rad_per_sec, float enc_b_rad_per_sec)
+static float rot_speeds_to_turn_rate(const struct hid_coeffs *coeffs,
+                                     float enc_a_rad_per_sec, float enc_b_rad_per_sec)
 {
-    return r_c*(enc_b_rad_per_sec-enc_a_rad_per_sec)/r_p;
+    return coeffs->r_c*(enc_b_rad_per_sec-enc_a_rad_per_sec)/coeffs->r_p;
 }
 
 /**
  * @brief Physical model for turning rotational speeds of rollers into
  *        player velocity.
  *
+ * @param coeffs Coefficients of the profile
  * @param enc_a_rad_per_sec Angular velocity of right-hand rollers (rad/s)
  * @param enc_b_rad_per_sec Angular velocity of left-hand rollers (rad/s)
  * @return float Velocity of player
  */
-static float rot_speeds_to_translational_speed(float enc_a_rad_per_sec, float enc_b_rad_per_sec)
+static float rot_speeds_to_translational_speed(const struct hid_coeffs *coeffs,
+                                               float enc_a_rad_per_sec, float enc_b_rad_per_sec)
 {
-    return r_c*(enc_a_rad_per_sec+enc_b_rad_per_sec);
+    return coeffs->r_c*(enc_a_rad_per_sec+enc_b_rad_per_sec);
 }
 
 /**
- * @brief maps a floating-point range to another floating-point range
- *          If the value is outside of the input range, it will be clamped.
- * 
- * @param value Value to map
- * @param input_start Start range of the input value
- * @param input_end End of range of the input value
- * @param output_start Start of range for the output value
- * @param output_end End of range for the input value
- * @return float the value mapped to the new range
+ * @brief Maps a signal in range [-1, 1] to a joystick axis value [0, 255],
+ *        applying the inversion and response curve of the axis.
+ *        If the signal is outside of the input range, it will be clamped.
+ *
+ * @param axis Precomputed axis mapping
+ * @param value Normalized signal
+ * @return uint8_t the axis value
  */
-static float map_range_f(float value, float input_start, float input_end, float output_start, float output_end)
+static uint8_t map_axis(const struct hid_axis_coeffs *axis, float value)
 {
-    float clamped_input = clamp_f(value, input_start, input_end);
-    float input_decimal = (clamped_input - input_start) / (input_end - input_start);
-    float output_without_start_offset = input_decimal * (output_end - output_start);
-    return output_start+output_without_start_offset;
+    float x = CLAMP(value, -1.0f, 1.0f);
+    float y = x * (axis->linear + axis->cubic * x * x);
+
+    return (uint8_t)((y + 1.0f) * 127.5f + 0.5f);
 }
+
 /**
- * @brief Maps a floating-point range to an uint8 range.
- *        If the value is outside of the input range
- *
- * @param value Value to map
- * @param input_start Start range of the input value
- * @param input_end End of range of the input value
- * @param output_start Start of range for the output value
- * @param output_end End of range for the input value
- * @return uint8_t the value mapped to the new range
+ * @brief Ensure that the sensitivity multiplier rises slightly slower
+ *        than the translational speed of the wheels.
+ * @param output Output holding the previous sensitivity
+ * @param sensitivity output from sensitivity mapping function
+ * @return float filtered sensitivity
  */
-static uint8_t map_range(float value, float input_start, float input_end, uint8_t output_start, uint8_t output_end)
+static float filter_sensitivity(struct hid_output *output, float sensitivity)
 {
-    float clamped_input = clamp_f(value, input_start, input_end);
-    float input_decimal = (clamped_input - input_start) / (input_end - input_start);
-    uint8_t output_without_start_offset = (uint8_t)(input_decimal * (float)(output_end - output_start) + 0.5);
-    return output_start + output_without_start_offset;
+    const struct hid_coeffs *coeffs = &output->profile->coeffs;
+    float filtered_sensitivity = coeffs->sensitivity_alpha*output->sensitivity+(1.0f-coeffs->sensitivity_alpha)*sensitivity;
+    output->sensitivity = MIN(filtered_sensitivity, sensitivity);
+    return output->sensitivity;
 }
 
 /**
- * @brief Convert encoder readings into a mapped uint8_t, ready for transmission
+ * @brief Turns rotational speeds into the turn rate shown to the player
  *
+ * @param output Output the turn rate is computed for
  * @param enc_a_rad_per_sec Angular velocity of right-hand rollers (rad/s)
  * @param enc_b_rad_per_sec Angular velocity of left-hand rollers (rad/s)
- * @return uint8_t A value in range 0-255 which describes how fast the player is to move forwards.
+ * @return float Turn rate after sensitivity (deg/s)
  */
-static uint8_t rot_speeds_to_hid_move_value(float enc_a_rad_per_sec, float enc_b_rad_per_sec)
+static float rot_speeds_to_output_turn_rate(struct hid_output *output,
+                                            float enc_a_rad_per_sec, float enc_b_rad_per_sec)
 {
-    float translational_speed = rot_speeds_to_translational_speed(enc_a_rad_per_sec, enc_b_rad_per_sec);
-    translational_speed *= -1; // y-axis seems to be inverted on game controllers, i.e. 0=positive, max and 255=negative
-    return map_range(translational_speed, -max_translational_speed_m_per_sec, max_translational_speed_m_per_sec, 0, 255);
+    const struct hid_coeffs *coeffs = &output->profile->coeffs;
+    float speed = rot_speeds_to_translational_speed(coeffs, enc_a_rad_per_sec, enc_b_rad_per_sec);
+    float speed_signed = speed;
+    speed = speed > 0.0 ? speed : -speed;
+    float clamped_speed = CLAMP(speed, coeffs->sensitivity_start_m_per_sec, coeffs->sensitivity_end_m_per_sec);
+    float difference_sensitivity = HID_SENSITIVITY_MAX + (clamped_speed - coeffs->sensitivity_start_m_per_sec) * coeffs->sensitivity_slope;
+    float filtered_difference_sensitivity = filter_sensitivity(output, difference_sensitivity);
+
+    float turn_rate = rot_speeds_to_turn_rate(coeffs, enc_a_rad_per_sec, enc_b_rad_per_sec) * coeffs->turn_scaling_deg;
+    float output_turn_rate = turn_rate * filtered_difference_sensitivity;
+    if (IS_ENABLED(CONFIG_HID_MODULE_TELEMETRY))
+    {
+        hid_telemetry.speed = speed_signed;
+        hid_telemetry.speed_clamped = CLAMP(speed_signed, -coeffs->max_translational_speed_m_per_sec,
+                                            coeffs->max_translational_speed_m_per_sec);
+        hid_telemetry.turn_rate = turn_rate;
+        hid_telemetry.output_turn_rate = output_turn_rate;
+        hid_telemetry.difference_sensitivity = difference_sensitivity;
+        hid_telemetry.filtered_difference_sensitivity = filtered_difference_sensitivity;
+    }
+    return output_turn_rate;
 }
 
 /**
- * @brief Ensure that the sensitivity multiplier rises slightly slower
- *        than the translational speed of the wheels.
- * @param sensitivity output from sensitivity mapping function
- * @return float filtered sensitivity
+ * @brief Computes every signal and places it on the joystick axes of the
+ *        report of an output, according to the axis mapping of its profile,
+ *        through the output filter chain of each axis
+ *
+ * @param output Output to update
+ * @param enc_a_rad_per_sec Angular velocity of right-hand rollers (rad/s)
+ * @param enc_b_rad_per_sec Angular velocity of left-hand rollers (rad/s)
  */
-static float filter_sensitivity(float sensitivity)
+static void rot_speeds_to_hid_report(struct hid_output *output,
+                                     float enc_a_rad_per_sec, float enc_b_rad_per_sec)
 {
-    static float prev_sensitivity_value = 1.0;
-    float filtered_sensitivity = sensitivity_alpha*prev_sensitivity_value+(1.0-sensitivity_alpha)*sensitivity;
-    prev_sensitivity_value = MIN(filtered_sensitivity, sensitivity);
-    return prev_sensitivity_value;
+    const struct hid_coeffs *coeffs = &output->profile->coeffs;
+    uint8_t *report = &output->report[INPUT_REP_AXES_OFFSET];
+    float signals[HID_SIGNAL_COUNT];
+
+    signals[HID_SIGNAL_ZERO] = 0.0f;
+    signals[HID_SIGNAL_TRANSLATION] = rot_speeds_to_translational_speed(coeffs, enc_a_rad_per_sec, enc_b_rad_per_sec) *
+                                      coeffs->translation_norm;
+    signals[HID_SIGNAL_TURN] = rot_speeds_to_output_turn_rate(output, enc_a_rad_per_sec, enc_b_rad_per_sec) *
+                               coeffs->turn_norm;
+    signals[HID_SIGNAL_LEFT_WHEEL] = coeffs->r_c * enc_b_rad_per_sec * coeffs->translation_norm;
+    signals[HID_SIGNAL_RIGHT_WHEEL] = coeffs->r_c * enc_a_rad_per_sec * coeffs->translation_norm;
+
+    for (size_t i = 0; i < HID_AXIS_COUNT; i++)
+    {
+        const struct hid_axis_coeffs *axis = &coeffs->axes[i];
+        float value = axis_filter_run(&axis->filter, &output->axes[i], signals[axis->signal]);
+
+#if IS_ENABLED(CONFIG_HID_MODULE_PREDICTOR)
+        value = predictor_run(&coeffs->predictor, &output->predictors[i], value);
+#endif
+
+        report[i] = map_axis(axis, value);
+    }
 }
 
 /**
- * @brief Slow start mapping of turning signal
- * 
- * @param turn_rate Unprocessed turning signal
- * @return float Turn signal, mapped to slow start
+ * @brief Integrates the raw encoder ticks of a sample into the odometry
+ *
+ * @param ticks_a Ticks of the right-hand rollers during the sample
+ * @param ticks_b Ticks of the left-hand rollers during the sample
  */
-static float slow_start(float turn_rate)
+static void update_odometry(int32_t ticks_a, int32_t ticks_b)
 {
-    float filter_start = 0.0;
-    float filter_end = 30.0; 
-    if (turn_rate <= filter_start)
+    const struct hid_coeffs *coeffs = &active_profile->coeffs;
+    struct odometry_report report;
+    k_spinlock_key_t key;
+
+    if (atomic_cas(&odometry_reset_pending, 1, 0))
     {
-        return 0.0;
+        dead_reckoning_reset(&odometry);
     }
-    if (turn_rate >= filter_end) {
-        return turn_rate;   
+    if (memcmp(&odometry_geometry, &coeffs->geometry, sizeof(odometry_geometry)) != 0)
+    {
+        /* Another profile, or retuned dimensions, must not rescale the
+         * distance and heading travelled so far.
+         */
+        dead_reckoning_rebase(&odometry, &odometry_geometry);
+        odometry_geometry = coeffs->geometry;
     }
-    return filter_end*pow((turn_rate-filter_start)/filter_end, 2);
+    dead_reckoning_update(&odometry, &coeffs->geometry, ticks_a, ticks_b);
+
+    report.distance_mm = (int32_t)(dead_reckoning_distance(&odometry, &coeffs->geometry) * 1000.0f);
+    report.x_mm = (int32_t)(odometry.x * 1000.0f);
+    report.y_mm = (int32_t)(odometry.y * 1000.0f);
+    report.heading_mdeg = (int32_t)(dead_reckoning_heading(&odometry) * 180000.0f / M_PI);
+
+    key = k_spin_lock(&odometry_lock);
+    odometry_report = report;
+    k_spin_unlock(&odometry_lock, key);
+}
+
+/**============================================
+ *         HID and connectivity-specific
+ *=============================================**/
+
+static struct hid_conn *find_hid_conn(const struct bt_conn *conn)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(hid_conns); i++)
+    {
+        if (hid_conns[i].conn == conn)
+        {
+            return &hid_conns[i];
+        }
+    }
+    return NULL;
 }
 
 /**
- * @brief Turns rotational speeds into a HID turn value
+ * @brief Notification completion callback, releases the peer for the next report
  *
- * @param enc_a_rad_per_sec Angular velocity of right-hand rollers (rad/s)
- * @param enc_b_rad_per_sec Angular velocity of left-hand rollers (rad/s)
- * @return uint8_t HID turning value between 0-255
+ * @param conn Connection the notification was sent on
+ * @param user_data Unused
  */
-static uint8_t rot_speeds_to_hid_turn_value(float enc_a_rad_per_sec, float enc_b_rad_per_sec)
+static void report_sent_cb(struct bt_conn *conn, void *user_data)
 {
-    float speed = rot_speeds_to_translational_speed(enc_a_rad_per_sec, enc_b_rad_per_sec);
-    float speed_signed = speed;
-    speed = speed > 0.0 ? speed : -speed;
-    float difference_sensitivity = map_range_f(speed, max_translational_speed_m_per_sec * difference_sensitivity_start, max_translational_speed_m_per_sec * difference_sensitivity_end, 1.0, 0.6);
-    float filtered_difference_sensitivity = filter_sensitivity(difference_sensitivity);
-
-    float turn_rate = rot_speeds_to_turn_rate(enc_a_rad_per_sec, enc_b_rad_per_sec) * HID_TURN_SCALING;
-    turn_rate = radian_to_degree(turn_rate);
-    float turn_rate_sign = turn_rate >= 0.0 ? 1.0 : -1.0;
-    turn_rate *= turn_rate_sign; // must be positive;
-    float filtered_turn_rate = turn_rate_sign * slow_start(turn_rate);
-    
-    float output_turn_rate = filtered_turn_rate * filtered_difference_sensitivity;
-#if IS_ENABLED(CONFIG_HID_MODULE_LOG_FOR_PLOT)
-    if (message_counter % readings_per_log == 0) {
-        LOG_DBG("S, SC, UTR, DS, FDS, FTR, FRTR = (%f, %f, %f, %f, %f, %f, %f)", speed_signed, CLAMP(speed_signed, -max_translational_speed_m_per_sec, max_translational_speed_m_per_sec), turn_rate, difference_sensitivity, filtered_difference_sensitivity, filtered_turn_rate, output_turn_rate);
+    struct hid_conn *hid_conn = find_hid_conn(conn);
+
+    if (hid_conn)
+    {
+#if IS_ENABLED(CONFIG_LATENCY_HIST)
+        latency_hist_add(LATENCY_REPORT_TO_SENT, hid_conn->report_cycles);
+        if (hid_conn->edge_cycles)
+        {
+            latency_hist_add(LATENCY_TOTAL, hid_conn->edge_cycles);
+        }
+#endif
+        atomic_set(&hid_conn->in_flight, 0);
     }
+}
+
+/**
+ * @brief Sends the report of a secured Bluetooth peer.
+ *        A peer which still has a notification in flight is skipped for
+ *        this sample so that a slow peer does not delay the others.
+ *        An unchanged report is only sent if the peer missed it.
+ *
+ * @param hid_conn Peer
+ * @param changed true if the report differs from the previous one
+ */
+static void send_ble_report(struct hid_conn *hid_conn, bool changed)
+{
+    int err;
+
+    if (!changed && !hid_conn->stale)
+    {
+        return;
+    }
+    if (!atomic_cas(&hid_conn->in_flight, 0, 1))
+    {
+        hid_conn->skipped++;
+        hid_conn->stale = true;
+        return;
+    }
+#if IS_ENABLED(CONFIG_LATENCY_HIST)
+    hid_conn->report_cycles = latency_stamp();
+    hid_conn->edge_cycles = report_edge_cycles;
 #endif
-    return map_range(output_turn_rate, -max_turn_rate_deg_per_sec, max_turn_rate_deg_per_sec, 0, 255);
+
+    err = bt_hids_inp_rep_send(&hids_obj, hid_conn->conn,
+                    INPUT_REP_GAMEPAD_INDEX,
+                    hid_conn->output.report, INPUT_REP_GAMEPAD_NUM_BYTES,
+                    report_sent_cb);
+    if (err)
+    {
+        atomic_set(&hid_conn->in_flight, 0);
+        hid_conn->stale = true;
+        LOG_ERR("Cannot send game pad report (%d)", err);
+        return;
+    }
+    hid_conn->stale = false;
+    report_stats.sent++;
+    if (hid_conn->first_report_pending)
+    {
+        hid_conn->first_report_pending = false;
+        LOG_INF("First report %u ms after connection",
+                k_uptime_get_32() - hid_conn->connected_ms);
+    }
 }
 
-/**============================================
- *         HID and connectivity-specific
- *=============================================**/
+/**
+ * @brief Logs the report rate once per statistics window
+ */
+static void update_report_stats(void)
+{
+    int64_t now = k_uptime_get();
+
+    if (now - report_stats.window_start < REPORT_STATS_WINDOW_MS)
+    {
+        return;
+    }
+    LOG_DBG("Reports per second: %u sent, %u unchanged",
+            (uint32_t)(report_stats.sent * 1000 / (now - report_stats.window_start)),
+            (uint32_t)(report_stats.unchanged * 1000 / (now - report_stats.window_start)));
+    if (IS_ENABLED(CONFIG_HID_MODULE_TELEMETRY))
+    {
+        struct telemetry_stats stats;
+
+        telemetry_stats_get(&stats);
+        LOG_DBG("Telemetry: %u frames, %u dropped, %u us mean, %u us max per frame",
+                stats.frames, stats.dropped,
+                (stats.frames + stats.dropped) ?
+                    k_cyc_to_us_floor32(stats.write_cycles / (stats.frames + stats.dropped)) : 0,
+                k_cyc_to_us_floor32(stats.write_cycles_max));
+    }
+    report_stats.sent = 0;
+    report_stats.unchanged = 0;
+    report_stats.window_start = now;
+}
 
 /**
- * @brief Formats and transmits the HID report over bluetooth
- * 
- * @param x_axis x-axis for joystick
- * @param y_axis y-axis for joystick
+ * @brief Completes the report of an output with the buttons and the timestamp
+ *
+ * @param output Output
+ * @param timestamp_ms Uptime when the data of the report was captured
+ * @return true if the report differs from the last one handed to the transport
+ */
+static bool output_update_report(struct hid_output *output, uint32_t timestamp_ms)
+{
+    bool changed;
+
+    sys_put_le16(buttons, &output->report[INPUT_REP_BUTTONS_OFFSET]);
+    if (IS_ENABLED(CONFIG_HID_MODULE_REPORT_TIMESTAMP))
+    {
+        sys_put_le16((uint16_t)timestamp_ms, &output->report[INPUT_REP_TIMESTAMP_OFFSET]);
+    }
+
+    changed = memcmp(output->report, output->last_report, sizeof(output->last_report)) != 0;
+    if (!changed)
+    {
+        report_stats.unchanged++;
+        return false;
+    }
+    memcpy(output->last_report, output->report, sizeof(output->last_report));
+
+    if (message_counter % readings_per_log == 0)
+    {
+        LOG_DBG("buttons, x, y, z, rz: (0x%04x, %d, %d, %d, %d)", buttons,
+                output->report[INPUT_REP_AXES_OFFSET], output->report[INPUT_REP_AXES_OFFSET + 1],
+                output->report[INPUT_REP_AXES_OFFSET + 2], output->report[INPUT_REP_AXES_OFFSET + 3]);
+    }
+    return true;
+}
+
+/**
+ * @brief Hands the game pad reports to the active transport if they changed.
+ *        USB is preferred when the device is enumerated by a host.
+ *
+ * @param timestamp_ms Uptime when the data of the reports was captured
+ */
+static void send_hid_report(uint32_t timestamp_ms)
+{
+    if (IS_ENABLED(CONFIG_HID_MODULE_USB) && hid_usb_is_active())
+    {
+        bool changed = output_update_report(&usb_output, timestamp_ms);
+
+        if (changed || !usb_was_active)
+        {
+            int err = hid_usb_send(INPUT_REP_REF_GAMEPAD_ID, usb_output.report, INPUT_REP_GAMEPAD_NUM_BYTES);
+
+            if (err)
+            {
+                LOG_ERR("Cannot send USB game pad report (%d)", err);
+            }
+            else
+            {
+                report_stats.sent++;
+            }
+        }
+        usb_was_active = true;
+    }
+    else
+    {
+        usb_was_active = false;
+        for (size_t i = 0; i < ARRAY_SIZE(hid_conns); i++)
+        {
+            if (hid_conns[i].conn && hid_conns[i].secured)
+            {
+                send_ble_report(&hid_conns[i], output_update_report(&hid_conns[i].output, timestamp_ms));
+            }
+        }
+    }
+
+    if (report_stats.sent)
+    {
+        boot_trace_done("first report");
+    }
+    update_report_stats();
+}
+
+/**
+ * @brief Updates the button bitmask of the game pad report
+ *
+ * @param event Button event
  */
-static void send_hid_report(uint8_t x_axis, uint8_t y_axis)
+static void button_event_to_hid_report(const struct button_event *event)
 {
-    if (!cur_conn || !secured)
+    if (event->key_id >= INPUT_REP_BUTTON_COUNT)
     {
         return;
     }
+    WRITE_BIT(buttons, event->key_id, event->pressed);
+}
+
+/**
+ * @brief Reads a feature report
+ *
+ * @param profile Profile the tuning report is read from
+ * @param report_id Report ID of the feature report
+ * @param data [output] Buffer for the report data, without report ID
+ * @param len Size of the buffer
+ * @return int Length of the report, or a negative error code
+ */
+static int feature_report_get(const struct hid_profile *profile, uint8_t report_id,
+                              uint8_t *data, size_t len)
+{
+    struct encoder_params enc_params = ENCODER_PARAMS_DEFAULT;
+    struct hid_tuning_params params;
+    struct hid_axis_map map;
+    k_spinlock_key_t key;
+
+    switch (report_id)
+    {
+    case FEATURE_REP_REF_TUNING_ID:
+        if (len < FEATURE_REP_TUNING_NUM_BYTES)
+        {
+            return -EMSGSIZE;
+        }
+        hid_profile_params_get(profile, &params);
+        memcpy(data, &params, FEATURE_REP_TUNING_NUM_BYTES);
+        return FEATURE_REP_TUNING_NUM_BYTES;
+
+    case FEATURE_REP_REF_ENCODER_ID:
+        if (len < FEATURE_REP_ENCODER_NUM_BYTES)
+        {
+            return -EMSGSIZE;
+        }
+        /* Defaults are reported until parameters have been stored. */
+        param_store_get(PARAM_STORE_ENCODER, &enc_params, sizeof(enc_params));
+        memcpy(data, &enc_params, FEATURE_REP_ENCODER_NUM_BYTES);
+        return FEATURE_REP_ENCODER_NUM_BYTES;
+
+    case FEATURE_REP_REF_AXIS_MAP_ID:
+        if (len < FEATURE_REP_AXIS_MAP_NUM_BYTES)
+        {
+            return -EMSGSIZE;
+        }
+        hid_profile_map_get(profile, &map);
+        memcpy(data, &map, FEATURE_REP_AXIS_MAP_NUM_BYTES);
+        return FEATURE_REP_AXIS_MAP_NUM_BYTES;
+
+    case FEATURE_REP_REF_ODOMETRY_ID:
+        if (len < FEATURE_REP_ODOMETRY_NUM_BYTES)
+        {
+            return -EMSGSIZE;
+        }
+        key = k_spin_lock(&odometry_lock);
+        memcpy(data, &odometry_report, FEATURE_REP_ODOMETRY_NUM_BYTES);
+        k_spin_unlock(&odometry_lock, key);
+        return FEATURE_REP_ODOMETRY_NUM_BYTES;
+
+    case FEATURE_REP_REF_CLOCK_ID:
+        if (len < FEATURE_REP_CLOCK_NUM_BYTES)
+        {
+            return -EMSGSIZE;
+        }
+        sys_put_le32(k_uptime_get_32(), data);
+        return FEATURE_REP_CLOCK_NUM_BYTES;
+
+    default:
+        return -ENOTSUP;
+    }
+}
+
+/**
+ * @brief Applies a feature report written by the host
+ *
+ * @param profile Profile the tuning report is written to
+ * @param report_id Report ID of the feature report
+ * @param data Report data, without report ID
+ * @param len Length of the report data
+ * @return int 0 if successful, otherwise a negative error code
+ */
+static int feature_report_set(struct hid_profile *profile, uint8_t report_id,
+                              const uint8_t *data, size_t len)
+{
+    struct hid_tuning_params params;
+    struct encoder_params enc_params;
+    struct hid_axis_map map;
     int err;
 
-    uint8_t send_buffer[INPUT_REP_JOYSTICK_NUM_BYTES];
+    switch (report_id)
+    {
+    case FEATURE_REP_REF_TUNING_ID:
+        if (len != FEATURE_REP_TUNING_NUM_BYTES)
+        {
+            return -EMSGSIZE;
+        }
+        memcpy(&params, data, sizeof(params));
+        err = hid_profile_params_set(profile, &params);
+        if (err)
+        {
+            LOG_WRN("Rejected invalid tuning parameters");
+        }
+        return err;
+
+    case FEATURE_REP_REF_ENCODER_ID:
+        if (len != FEATURE_REP_ENCODER_NUM_BYTES)
+        {
+            return -EMSGSIZE;
+        }
+        memcpy(&enc_params, data, sizeof(enc_params));
+        if (!encoder_params_valid(&enc_params))
+        {
+            LOG_WRN("Rejected invalid encoder parameters");
+            return -EINVAL;
+        }
+        /* Picked up by the encoder module on its next sample. */
+        return param_store_set(PARAM_STORE_ENCODER, &enc_params, sizeof(enc_params));
+
+    case FEATURE_REP_REF_AXIS_MAP_ID:
+        if (len != FEATURE_REP_AXIS_MAP_NUM_BYTES)
+        {
+            return -EMSGSIZE;
+        }
+        memcpy(&map, data, sizeof(map));
+        err = hid_profile_map_set(profile, &map);
+        if (err)
+        {
+            LOG_WRN("Rejected invalid axis mapping");
+        }
+        return err;
+
+    case FEATURE_REP_REF_ODOMETRY_ID:
+        if (len != FEATURE_REP_ODOMETRY_NUM_BYTES)
+        {
+            return -EMSGSIZE;
+        }
+        atomic_set(&odometry_reset_pending, 1);
+        return 0;
+
+    default:
+        return -ENOTSUP;
+    }
+}
+
+/**
+ * @brief Finds the profile a Bluetooth peer reads and writes
+ *
+ * @param conn Connection of the peer
+ * @return struct hid_profile* Profile of the peer, or the default profile
+ *         if the link is not yet secured
+ */
+static struct hid_profile *profile_for_conn(const struct bt_conn *conn)
+{
+    struct hid_conn *hid_conn = find_hid_conn(conn);
 
-    if (IS_ENABLED(CONFIG_HID_MODULE_CONTROLLER_OUTPUT_A))
+    if (hid_conn && hid_conn->profile)
+    {
+        return hid_conn->profile;
+    }
+    return hid_profile_default();
+}
+
+/**
+ * @brief Bluetooth handler of the encoder feature report
+ *
+ * @param rep Report data buffer
+ * @param conn Connection which accessed the report
+ * @param write true if the peer wrote the report, false on read
+ */
+static void encoder_report_handler(struct bt_hids_rep *rep, struct bt_conn *conn, bool write)
+{
+    if (write)
     {
-        const uint8_t output[INPUT_REP_JOYSTICK_NUM_BYTES] = {x_axis, y_axis, joystick_neutral, joystick_neutral};
-        memcpy(send_buffer, output, sizeof(output));
+        feature_report_set(profile_for_conn(conn), FEATURE_REP_REF_ENCODER_ID, rep->data, rep->size);
     }
-    else {
-        const uint8_t output[INPUT_REP_JOYSTICK_NUM_BYTES] = {joystick_neutral, y_axis, x_axis, joystick_neutral};
-        memcpy(send_buffer, output, sizeof(output));
+    else
+    {
+        feature_report_get(profile_for_conn(conn), FEATURE_REP_REF_ENCODER_ID, rep->data, rep->size);
     }
+}
 
-    err = bt_hids_inp_rep_send(&hids_obj, cur_conn,
-                    INPUT_REP_JOYSTICK_INDEX,
-                    send_buffer, INPUT_REP_JOYSTICK_NUM_BYTES, NULL);
-    if (err)
+/* USB hosts read and write the default profile, see hid_profile.h. */
+static int usb_feature_get(uint8_t report_id, uint8_t *data, size_t len)
+{
+    return feature_report_get(hid_profile_default(), report_id, data, len);
+}
+
+static int usb_feature_set(uint8_t report_id, const uint8_t *data, size_t len)
+{
+    return feature_report_set(hid_profile_default(), report_id, data, len);
+}
+
+static const struct hid_usb_feature_cb usb_feature_cb = {
+    .get = usb_feature_get,
+    .set = usb_feature_set,
+};
+
+/**
+ * @brief Bluetooth handler of the tuning feature report
+ *
+ * @param rep Report data buffer
+ * @param conn Connection which accessed the report
+ * @param write true if the peer wrote the report, false on read
+ */
+static void tuning_report_handler(struct bt_hids_rep *rep, struct bt_conn *conn, bool write)
+{
+    if (write)
     {
-        LOG_ERR("Cannot send left joystick report (%d)", err);
-        return;
+        feature_report_set(profile_for_conn(conn), FEATURE_REP_REF_TUNING_ID, rep->data, rep->size);
     }
-    if (message_counter % readings_per_log == 0)
+    else
+    {
+        feature_report_get(profile_for_conn(conn), FEATURE_REP_REF_TUNING_ID, rep->data, rep->size);
+    }
+}
+
+/**
+ * @brief Bluetooth handler of the axis mapping feature report
+ *
+ * @param rep Report data buffer
+ * @param conn Connection which accessed the report
+ * @param write true if the peer wrote the report, false on read
+ */
+static void axis_map_report_handler(struct bt_hids_rep *rep, struct bt_conn *conn, bool write)
+{
+    if (write)
     {
-        LOG_DBG("x_axis, y_axis: (%d, %d)", x_axis, y_axis);
+        feature_report_set(profile_for_conn(conn), FEATURE_REP_REF_AXIS_MAP_ID, rep->data, rep->size);
+    }
+    else
+    {
+        feature_report_get(profile_for_conn(conn), FEATURE_REP_REF_AXIS_MAP_ID, rep->data, rep->size);
+    }
+}
+
+/**
+ * @brief Bluetooth handler of the odometry feature report
+ *
+ * @param rep Report data buffer
+ * @param conn Connection which accessed the report
+ * @param write true if the peer wrote the report, false on read
+ */
+static void odometry_report_handler(struct bt_hids_rep *rep, struct bt_conn *conn, bool write)
+{
+    if (write)
+    {
+        feature_report_set(profile_for_conn(conn), FEATURE_REP_REF_ODOMETRY_ID, rep->data, rep->size);
+    }
+    else
+    {
+        feature_report_get(profile_for_conn(conn), FEATURE_REP_REF_ODOMETRY_ID, rep->data, rep->size);
+    }
+}
+
+/**
+ * @brief Bluetooth handler of the device clock feature report
+ *
+ * @param rep Report data buffer
+ * @param conn Connection which accessed the report
+ * @param write true if the peer wrote the report, false on read
+ */
+static void clock_report_handler(struct bt_hids_rep *rep, struct bt_conn *conn, bool write)
+{
+    if (!write)
+    {
+        feature_report_get(profile_for_conn(conn), FEATURE_REP_REF_CLOCK_ID, rep->data, rep->size);
     }
 }
 
 /**========================================================================
  *                           Event handlers
  *========================================================================**/
+/**
+ * @brief Makes a profile the one used for the odometry. The reports of
+ *        every host keep their own profile.
+ *
+ * @param profile Profile to activate
+ */
+static void activate_profile(struct hid_profile *profile)
+{
+    struct hid_tuning_params params;
+
+    if (profile == active_profile)
+    {
+        return;
+    }
+    active_profile = profile;
+    hid_profile_params_get(profile, &params);
+    LOG_INF("Profile activated, max speed: %u [mm/s], max turn rate: %u [deg/s]",
+            params.max_speed_mm_per_sec, params.max_turn_rate_deg_per_sec);
+}
+
+/**
+ * @brief Moves the peers of a cleared profile to the default profile
+ *
+ * @param profile Cleared profile, or NULL if every per-peer profile was cleared
+ */
+static void drop_cleared_profile(const struct hid_profile *profile)
+{
+    struct hid_profile *fallback = hid_profile_default();
+
+    for (size_t i = 0; i < ARRAY_SIZE(hid_conns); i++)
+    {
+        if (hid_conns[i].profile && (hid_conns[i].profile != fallback) &&
+            (!profile || (hid_conns[i].profile == profile)))
+        {
+            hid_conns[i].profile = fallback;
+            output_init(&hid_conns[i].output, fallback);
+        }
+    }
+    if ((active_profile != fallback) && (!profile || (active_profile == profile)))
+    {
+        activate_profile(fallback);
+    }
+}
+
+/* Identity addresses of peers whose bond was deleted, passed from the
+ * Bluetooth stack to the system work queue.
+ */
+K_MSGQ_DEFINE(removed_peers, sizeof(bt_addr_le_t), CONFIG_BT_MAX_PAIRED, 1);
+
+static void removed_peers_work_handler(struct k_work *work)
+{
+    bt_addr_le_t addr;
+    struct hid_profile *profile;
+
+    while (!k_msgq_get(&removed_peers, &addr, K_NO_WAIT))
+    {
+        profile = hid_profile_remove_peer(&addr);
+        if (profile)
+        {
+            drop_cleared_profile(profile);
+        }
+    }
+}
+
+static K_WORK_DEFINE(removed_peers_work, removed_peers_work_handler);
+
+static void bond_deleted(uint8_t id, const bt_addr_le_t *peer)
+{
+    if (k_msgq_put(&removed_peers, peer, K_NO_WAIT))
+    {
+        LOG_WRN("Profile of removed peer not cleared");
+    }
+    k_work_submit(&removed_peers_work);
+}
+
+static struct bt_conn_auth_info_cb auth_info_cb = {
+    .bond_deleted = bond_deleted,
+};
+
 static int module_init(void)
 {
-    LOG_INF("r_c: %f[m], r_p: %f[m]", r_c, r_p);
-    LOG_INF("Max translational speed: +-%f [m/s]", max_translational_speed_m_per_sec);
-    LOG_INF("Max turn rate: +-%f [deg/s]", max_turn_rate_deg_per_sec);
-    LOG_INF("Alpha for encoder: %f", ((float)(CONFIG_ENCODER_MOVING_AVERAGE_ALPHA)/1000.0));
-    LOG_INF("dt: %f[ms]", (float)CONFIG_ENCODER_DELTA_TIME_MSEC);
+    struct hid_tuning_params params;
+    int err;
+
+    hid_profile_init();
+    output_init(&usb_output, hid_profile_default());
+    activate_profile(hid_profile_default());
+    /* Integers only, floats are not formatted without CONFIG_CBPRINTF_FP_SUPPORT. */
+    hid_profile_params_get(hid_profile_default(), &params);
+    LOG_INF("Cylinder diameter: %u [mm], inter-wheel distance: %u [mm]",
+            params.cylinder_diameter_mm, params.inter_wheel_distance_mm);
+    LOG_INF("Max translational speed: +-%u [mm/s]", params.max_speed_mm_per_sec);
+    LOG_INF("Max turn rate: +-%u [deg/s]", params.max_turn_rate_deg_per_sec);
     LOG_INF("Encoder readings per log output: %d", readings_per_log);
-    LOG_INF("Difference sensitivty start threshold: %f*max trans speed", difference_sensitivity_start);
-    LOG_INF("Difference sensitivity end threshold: %f*max trans speed", difference_sensitivity_end);
+    LOG_INF("Difference sensitivty start threshold: %u [permille of max speed]",
+            params.sensitivity_start_permille);
+    LOG_INF("Difference sensitivity end threshold: %u [permille of max speed]",
+            params.sensitivity_end_permille);
 
     /* HID service configuration */
     struct bt_hids_init_param hids_init_param = {0};
@@ -344,38 +1045,119 @@ static int module_init(void)
     struct bt_hids_inp_rep *hids_input_report =
         &hids_init_param.inp_rep_group_init.reports[0];
 
-    hids_input_report->size = INPUT_REP_BUTTONS_NUM_BYTES;
-    hids_input_report->id = INPUT_REP_REF_BUTTONS_ID;
+    hids_input_report->size = INPUT_REP_GAMEPAD_NUM_BYTES;
+    hids_input_report->id = INPUT_REP_REF_GAMEPAD_ID;
     hids_input_report->rep_mask = NULL;
     hids_init_param.inp_rep_group_init.cnt++;
 
-    hids_input_report++;
-    hids_input_report->size = INPUT_REP_JOYSTICK_NUM_BYTES;
-    hids_input_report->id = INPUT_REP_REF_JOYSTICK_ID;
-    hids_input_report->rep_mask = NULL;
-    hids_init_param.inp_rep_group_init.cnt++;
+    struct bt_hids_outp_feat_rep *hids_feature_report =
+        &hids_init_param.feat_rep_group_init.reports[FEATURE_REP_TUNING_INDEX];
+
+    hids_feature_report->size = FEATURE_REP_TUNING_NUM_BYTES;
+    hids_feature_report->id = FEATURE_REP_REF_TUNING_ID;
+    hids_feature_report->handler = tuning_report_handler;
+    hids_init_param.feat_rep_group_init.cnt++;
+
+    hids_feature_report++;
+    hids_feature_report->size = FEATURE_REP_ENCODER_NUM_BYTES;
+    hids_feature_report->id = FEATURE_REP_REF_ENCODER_ID;
+    hids_feature_report->handler = encoder_report_handler;
+    hids_init_param.feat_rep_group_init.cnt++;
+
+    hids_feature_report++;
+    hids_feature_report->size = FEATURE_REP_AXIS_MAP_NUM_BYTES;
+    hids_feature_report->id = FEATURE_REP_REF_AXIS_MAP_ID;
+    hids_feature_report->handler = axis_map_report_handler;
+    hids_init_param.feat_rep_group_init.cnt++;
+
+    hids_feature_report++;
+    hids_feature_report->size = FEATURE_REP_ODOMETRY_NUM_BYTES;
+    hids_feature_report->id = FEATURE_REP_REF_ODOMETRY_ID;
+    hids_feature_report->handler = odometry_report_handler;
+    hids_init_param.feat_rep_group_init.cnt++;
+
+    hids_feature_report++;
+    hids_feature_report->size = FEATURE_REP_CLOCK_NUM_BYTES;
+    hids_feature_report->id = FEATURE_REP_REF_CLOCK_ID;
+    hids_feature_report->handler = clock_report_handler;
+    hids_init_param.feat_rep_group_init.cnt++;
+
+    if (IS_ENABLED(CONFIG_HID_MODULE_USB))
+    {
+        hid_usb_set_feature_cb(&usb_feature_cb);
+    }
+
+    err = bt_conn_auth_info_cb_register(&auth_info_cb);
+    if (err)
+    {
+        LOG_ERR("Failed to register the bond callbacks");
+        return err;
+    }
 
     return bt_hids_init(&hids_obj, &hids_init_param);
 }
 
 /**
- * @brief Handle the encoder event, creating HID turn rate 
- * and translational speeds from encoder rotational speeds-
+ * @brief Collects the outputs that reports are built for: those of the
+ *        secured Bluetooth peers, or the USB output while a USB host is
+ *        active or no peer is secured
+ *
+ * @param outputs [output] Outputs
+ * @return size_t Number of outputs, at least one
+ */
+static size_t active_outputs(struct hid_output *outputs[CONFIG_BT_MAX_CONN])
+{
+    size_t count = 0;
+
+    if (!(IS_ENABLED(CONFIG_HID_MODULE_USB) && hid_usb_is_active()))
+    {
+        for (size_t i = 0; i < ARRAY_SIZE(hid_conns); i++)
+        {
+            if (hid_conns[i].conn && hid_conns[i].secured)
+            {
+                outputs[count++] = &hid_conns[i].output;
+            }
+        }
+    }
+    if (count == 0)
+    {
+        outputs[count++] = &usb_output;
+    }
+    return count;
+}
+
+/**
+ * @brief Handle the encoder event, creating the HID joystick reports
+ * from encoder rotational speeds. Every sample of the batch runs through
+ * the output filters of every active output and the odometry, the reports
+ * hold the last one.
  * 
  * @param event Encoder module event containing rotational speeds from encoder A and B
- * @param turn_rate [output] HID turn rate value
- * @param trans_speed [output] HID translational speed value
  */
-static void encoder_event_to_hid_value(const struct encoder_module_event *event, uint8_t *turn_rate, uint8_t *trans_speed)
+static void encoder_event_to_hid_report(const struct encoder_module_event *event)
 {
-    if (event->type != ENCODER_EVT_DATA_READY)
+    struct hid_output *outputs[CONFIG_BT_MAX_CONN];
+    size_t output_count = active_outputs(outputs);
+
+    for (size_t i = 0; i < event->sample_count; i++)
     {
-        return;
+        const struct encoder_sample *sample = &event->samples[i];
+        float enc_a_rad_per_sec = degree_to_radian(sample->rot_speed_a);
+        float enc_b_rad_per_sec = degree_to_radian(sample->rot_speed_b);
+
+        for (size_t j = 0; j < output_count; j++)
+        {
+            rot_speeds_to_hid_report(outputs[j], enc_a_rad_per_sec, enc_b_rad_per_sec);
+            if (IS_ENABLED(CONFIG_HID_MODULE_TELEMETRY) && (j == 0))
+            {
+                /* One frame per sample, of the first output. */
+                memcpy(hid_telemetry.axes, &outputs[j]->report[INPUT_REP_AXES_OFFSET],
+                       sizeof(hid_telemetry.axes));
+                telemetry_write(TELEMETRY_FRAME_HID, &hid_telemetry, sizeof(hid_telemetry));
+            }
+        }
+        update_odometry(sample->ticks_a, sample->ticks_b);
     }
-    float enc_a_rad_per_sec = degree_to_radian(event->rot_speed_a);
-    float enc_b_rad_per_sec = degree_to_radian(event->rot_speed_b);
-    (*turn_rate) = rot_speeds_to_hid_turn_value(enc_a_rad_per_sec, enc_b_rad_per_sec);
-    (*trans_speed) = rot_speeds_to_hid_move_value(enc_a_rad_per_sec, enc_b_rad_per_sec);
 }
 
 /**
@@ -386,12 +1168,20 @@ static void encoder_event_to_hid_value(const struct encoder_module_event *event,
 static void notify_hids(const struct ble_peer_event *event)
 {
     int err = 0;
+    struct hid_conn *hid_conn;
 
     switch (event->state)
     {
     case PEER_STATE_CONNECTED:
-        __ASSERT_NO_MSG(cur_conn == NULL);
-        cur_conn = event->id;
+        hid_conn = find_hid_conn(NULL);
+        __ASSERT_NO_MSG(hid_conn != NULL);
+        hid_conn->conn = event->id;
+        hid_conn->secured = false;
+        hid_conn->skipped = 0;
+        hid_conn->stale = true;
+        hid_conn->connected_ms = k_uptime_get_32();
+        hid_conn->first_report_pending = true;
+        atomic_set(&hid_conn->in_flight, 0);
         err = bt_hids_connected(&hids_obj, event->id);
         if (err)
         {
@@ -401,11 +1191,32 @@ static void notify_hids(const struct ble_peer_event *event)
         break;
 
     case PEER_STATE_DISCONNECTED:
-        __ASSERT_NO_MSG(cur_conn == event->id);
+        hid_conn = find_hid_conn(event->id);
+        __ASSERT_NO_MSG(hid_conn != NULL);
         err = bt_hids_disconnected(&hids_obj, event->id);
-        cur_conn = NULL;
-        secured = false;
-        protocol_boot = false;
+        LOG_DBG("Peer disconnected, %u reports skipped", hid_conn->skipped);
+        hid_conn->conn = NULL;
+        hid_conn->secured = false;
+        if (hid_conn->profile)
+        {
+            hid_profile_release(hid_conn->profile);
+        }
+        if (hid_conn->profile == active_profile)
+        {
+            /* Fall back to another secured peer, if any. */
+            struct hid_profile *next = hid_profile_default();
+
+            for (size_t i = 0; i < ARRAY_SIZE(hid_conns); i++)
+            {
+                if (hid_conns[i].conn && hid_conns[i].profile &&
+                    hid_conns[i].profile->last_used >= next->last_used)
+                {
+                    next = hid_conns[i].profile;
+                }
+            }
+            activate_profile(next);
+        }
+        hid_conn->profile = NULL;
         if (err)
         {
             LOG_ERR("Connection context was not allocated");
@@ -413,8 +1224,22 @@ static void notify_hids(const struct ble_peer_event *event)
         break;
 
     case PEER_STATE_SECURED:
-        __ASSERT_NO_MSG(cur_conn == event->id);
-        secured = true;
+        hid_conn = find_hid_conn(event->id);
+        __ASSERT_NO_MSG(hid_conn != NULL);
+        hid_conn->secured = true;
+        hid_conn->profile = hid_profile_for_peer(bt_conn_get_dst(event->id));
+        output_init(&hid_conn->output, hid_conn->profile);
+        activate_profile(hid_conn->profile);
+        if (!hid_usb_is_active())
+        {
+            /* A bonded peer has its CCC restored by now, so hand it the
+             * current report instead of waiting for the next sample. The
+             * encoder does not sample at all while the wheels are still.
+             * The axes are neutral until the next sample.
+             */
+            output_update_report(&hid_conn->output, k_uptime_get_32());
+            send_ble_report(hid_conn, false);
+        }
         break;
 
     case PEER_STATE_DISCONNECTING:
@@ -439,22 +1264,83 @@ static bool app_event_handler(const struct app_event_header *aeh)
 {
     if (is_encoder_module_event(aeh))
     {
-        uint8_t trans_speed = 0;
-        uint8_t turn_rate = 0;
-        
-        encoder_event_to_hid_value(cast_encoder_module_event(aeh), &turn_rate, &trans_speed);
-        send_hid_report(turn_rate, trans_speed);
+        const struct encoder_module_event *event = cast_encoder_module_event(aeh);
+
+        if (!active_profile || (event->type != ENCODER_EVT_DATA_READY) || !event->sample_count)
+        {
+            /* Not initialized yet, or no samples. */
+            return false;
+        }
+        hid_profile_update();
+        encoder_event_to_hid_report(event);
+#if IS_ENABLED(CONFIG_LATENCY_HIST)
+        latency_hist_add(LATENCY_SUBMIT_TO_REPORT, event->submit_cycles);
+        for (int i = 0; i < event->sample_count; i++)
+        {
+            if (event->samples[i].edge_cycles)
+            {
+                report_edge_cycles = event->samples[i].edge_cycles;
+                break;
+            }
+        }
+#endif
+        send_hid_report(event->samples[event->sample_count - 1].timestamp_ms);
+#if IS_ENABLED(CONFIG_LATENCY_HIST)
+        report_edge_cycles = 0;
+#endif
 
         message_counter++;
         return false;
     }
 
+    if (is_button_event(aeh))
+    {
+        if (!active_profile)
+        {
+            return false;
+        }
+        button_event_to_hid_report(cast_button_event(aeh));
+        send_hid_report(k_uptime_get_32());
+
+        return false;
+    }
+
+    if (is_app_module_event(aeh))
+    {
+        const struct app_module_event *event = cast_app_module_event(aeh);
+
+        if (active_profile && (event->type == APP_EVT_POWER_STATE) &&
+            (event->data.power_state == APP_POWER_CONNECTED_IDLE))
+        {
+            /* The encoder stops sampling, so retry a report that was
+             * skipped while a notification was in flight now.
+             */
+            send_hid_report(k_uptime_get_32());
+        }
+        return false;
+    }
+
     if (is_ble_peer_event(aeh))
     {
         notify_hids(cast_ble_peer_event(aeh));
 
         return false;
     }
+
+    if (is_ble_peer_operation_event(aeh))
+    {
+        const struct ble_peer_operation_event *event = cast_ble_peer_operation_event(aeh);
+
+        if (active_profile && (event->op == PEER_OPERATION_ERASED))
+        {
+            /* The stack reports every erased bond through bond_deleted
+             * as well, which then finds the profile already cleared.
+             */
+            hid_profile_remove_all();
+            drop_cleared_profile(NULL);
+        }
+        return false;
+    }
     
     if (is_module_state_event(aeh))
     {
@@ -470,11 +1356,20 @@ static bool app_event_handler(const struct app_event_header *aeh)
             if (module_init())
             {
                 LOG_ERR("Service init failed");
+                module_set_state(MODULE_STATE_ERROR);
 
                 return false;
             }
             LOG_INF("Service initialized");
+            module_set_state(MODULE_STATE_READY);
         }
+#if IS_ENABLED(CONFIG_PARAM_STORE)
+        else if (check_state(event, MODULE_ID(settings_loader), MODULE_STATE_READY))
+        {
+            /* The stored profiles are picked up by hid_profile_update. */
+            param_store_load();
+        }
+#endif
         return false;
     }
 
@@ -485,6 +1380,9 @@ static bool app_event_handler(const struct app_event_header *aeh)
 
 APP_EVENT_LISTENER(MODULE, app_event_handler);
 APP_EVENT_SUBSCRIBE(MODULE, encoder_module_event);
+APP_EVENT_SUBSCRIBE(MODULE, button_event);
 APP_EVENT_SUBSCRIBE(MODULE, hid_notification_event);
 APP_EVENT_SUBSCRIBE(MODULE, module_state_event);
+APP_EVENT_SUBSCRIBE(MODULE, app_module_event);
+APP_EVENT_SUBSCRIBE(MODULE, ble_peer_operation_event);
 APP_EVENT_SUBSCRIBE_EARLY(MODULE, ble_peer_event);
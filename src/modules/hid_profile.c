@@ -0,0 +1,549 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/bluetooth/addr.h>
+
+#include "hid_profile.h"
+#include "encoder_params.h"
+#include "param_store.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(hid_profile, CONFIG_HID_MODULE_LOG_LEVEL);
+
+#define RAD_TO_DEG 57.295779513082320876798154814105f
+#define TWO_PI 6.283185307179586476925286766559f
+#define TICKS_PER_ROTATION DT_PROP(DT_NODELABEL(qdeca), ticks_per_rotation)
+
+BUILD_ASSERT(sizeof(struct hid_tuning_params) == 16,
+             "Tuning parameters must match the feature report in hid_report_desc.c");
+BUILD_ASSERT(sizeof(struct hid_axis_map) == 48,
+             "Axis mapping must match the feature report in hid_report_desc.c");
+
+/**
+ * @brief Stored form of a per-peer profile
+ */
+struct profile_record {
+    bt_addr_le_t addr;
+    struct hid_tuning_params params;
+    struct hid_axis_map map;
+} __packed;
+
+#if IS_ENABLED(CONFIG_PARAM_STORE)
+BUILD_ASSERT(sizeof(struct profile_record) <= CONFIG_PARAM_STORE_BLOB_MAX_SIZE);
+#endif
+
+static const struct hid_tuning_params default_params = {
+    .max_speed_mm_per_sec = CONFIG_HID_MODULE_MAX_OUTPUT_SPEED_MM_PER_SEC,
+    .max_turn_rate_deg_per_sec = CONFIG_HID_MODULE_MAX_OUTPUT_TURN_RATE_DEG_PER_SEC,
+    .sensitivity_start_permille = CONFIG_HID_MODULE_SENSITIVITY_START_PERMILLE,
+    .sensitivity_end_permille = CONFIG_HID_MODULE_SENSITIVITY_END_PERMILLE,
+    .sensitivity_alpha_permille = CONFIG_HID_MODULE_SENSITIVITY_ALPHA_PERMILLE,
+    .turn_scaling_permille = CONFIG_HID_MODULE_TURN_SCALING_MULTIPLIER_THOUSANDTHS,
+    .cylinder_diameter_mm = CONFIG_APP_CYLINDER_DIAMETER_MM,
+    .inter_wheel_distance_mm = CONFIG_APP_INTER_WHEEL_DISTANCE_MM,
+};
+
+#define TURN_AXIS_DEFAULT {                                                 \
+    .signal = HID_SIGNAL_TURN,                                              \
+    .filter = { .knee_permille = CONFIG_HID_MODULE_SLOW_START_KNEE_PERMILLE }, \
+}
+
+/* The y-axis is inverted on game controllers, i.e. 0 is forwards. */
+static const struct hid_axis_map default_map = {
+#if IS_ENABLED(CONFIG_HID_MODULE_CONTROLLER_OUTPUT_A)
+    .axes = {
+        [HID_AXIS_X] = TURN_AXIS_DEFAULT,
+        [HID_AXIS_Y] = { .signal = HID_SIGNAL_TRANSLATION, .invert = 1 },
+        [HID_AXIS_Z] = { .signal = HID_SIGNAL_ZERO },
+        [HID_AXIS_RZ] = { .signal = HID_SIGNAL_ZERO },
+    },
+#else
+    .axes = {
+        [HID_AXIS_X] = { .signal = HID_SIGNAL_ZERO },
+        [HID_AXIS_Y] = { .signal = HID_SIGNAL_TRANSLATION, .invert = 1 },
+        [HID_AXIS_Z] = TURN_AXIS_DEFAULT,
+        [HID_AXIS_RZ] = { .signal = HID_SIGNAL_ZERO },
+    },
+#endif
+};
+
+/* The default profile followed by the per-peer profiles. */
+static struct hid_profile profiles[1 + CONFIG_HID_MODULE_PROFILE_COUNT];
+
+/* Protects the params, map and addr fields of the profiles. */
+static struct k_spinlock profile_lock;
+static uint32_t use_counter;
+/* Set once the stored profiles replaced the defaults. */
+static bool profiles_loaded;
+/* Set if the default profile was changed before the store was loaded. */
+static bool default_pending;
+
+/* Encoder sample period used for the output filters */
+static float sample_period_s;
+static uint32_t encoder_generation;
+
+/**
+ * @brief Checks that tuning parameters give a well-defined model
+ *
+ * @param params Tuning parameters
+ * @return 0 if valid, -EINVAL otherwise
+ */
+static int validate_params(const struct hid_tuning_params *params)
+{
+    if (params->max_speed_mm_per_sec == 0 ||
+        params->max_turn_rate_deg_per_sec == 0 ||
+        params->sensitivity_start_permille >= params->sensitivity_end_permille ||
+        params->sensitivity_alpha_permille >= 1000 ||
+        params->cylinder_diameter_mm == 0 ||
+        params->inter_wheel_distance_mm == 0)
+    {
+        return -EINVAL;
+    }
+    return 0;
+}
+
+/**
+ * @brief Checks that an axis mapping only refers to known signals
+ *
+ * @param map Axis mapping
+ * @return 0 if valid, -EINVAL otherwise
+ */
+static int validate_map(const struct hid_axis_map *map)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(map->axes); i++)
+    {
+        if (map->axes[i].signal >= HID_SIGNAL_COUNT ||
+            map->axes[i].invert > 1 ||
+            map->axes[i].expo_permille > 1000 ||
+            !axis_filter_config_valid(&map->axes[i].filter))
+        {
+            return -EINVAL;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Computes the derived coefficients from the tuning parameters and axis mapping
+ *
+ * @param params Tuning parameters
+ * @param map Axis mapping
+ * @param out [output] Derived coefficients
+ */
+static void compute_coeffs(const struct hid_tuning_params *params, const struct hid_axis_map *map,
+                           struct hid_coeffs *out)
+{
+    out->r_c = (float)params->cylinder_diameter_mm / (2.0f*1000.0f);
+    out->r_p = (float)params->inter_wheel_distance_mm / (2.0f*1000.0f);
+    out->max_translational_speed_m_per_sec = (float)params->max_speed_mm_per_sec / 1000.0f;
+    out->max_turn_rate_deg_per_sec = (float)params->max_turn_rate_deg_per_sec;
+    out->sensitivity_start_m_per_sec = out->max_translational_speed_m_per_sec *
+                                       (float)params->sensitivity_start_permille / 1000.0f;
+    out->sensitivity_end_m_per_sec = out->max_translational_speed_m_per_sec *
+                                     (float)params->sensitivity_end_permille / 1000.0f;
+    out->sensitivity_slope = (HID_SENSITIVITY_MIN - HID_SENSITIVITY_MAX) /
+                             (out->sensitivity_end_m_per_sec - out->sensitivity_start_m_per_sec);
+    out->sensitivity_alpha = (float)params->sensitivity_alpha_permille / 1000.0f;
+    out->turn_scaling_deg = (float)params->turn_scaling_permille / 1000.0f * RAD_TO_DEG;
+    out->geometry.m_per_tick = out->r_c * TWO_PI / TICKS_PER_ROTATION;
+    out->geometry.half_track = out->r_p;
+    out->translation_norm = 1.0f / out->max_translational_speed_m_per_sec;
+    out->turn_norm = 1.0f / out->max_turn_rate_deg_per_sec;
+
+    for (size_t i = 0; i < ARRAY_SIZE(out->axes); i++)
+    {
+        const struct hid_axis_config *axis = &map->axes[i];
+        float sign = axis->invert ? -1.0f : 1.0f;
+        float expo = (float)axis->expo_permille / 1000.0f;
+
+        out->axes[i].signal = axis->signal;
+        out->axes[i].linear = sign * (1.0f - expo);
+        out->axes[i].cubic = sign * expo;
+        axis_filter_coeffs_compute(&axis->filter, sample_period_s, &out->axes[i].filter);
+    }
+
+#if IS_ENABLED(CONFIG_HID_MODULE_PREDICTOR)
+    predictor_coeffs_compute((float)CONFIG_HID_MODULE_PREDICTOR_HORIZON_MS / 1000.0f,
+                             (float)CONFIG_HID_MODULE_PREDICTOR_MAX_LEAD_PERMILLE / 1000.0f,
+                             sample_period_s, &out->predictor);
+#endif
+}
+
+static bool is_default(const struct hid_profile *profile)
+{
+    return profile == &profiles[0];
+}
+
+static enum param_store_id store_id(const struct hid_profile *profile)
+{
+    return PARAM_STORE_PROFILE_FIRST + (profile - &profiles[1]);
+}
+
+/**
+ * @brief Schedules the profile for storage
+ *
+ * @param profile Profile to store
+ */
+static void store_profile(const struct hid_profile *profile)
+{
+    struct profile_record record;
+    k_spinlock_key_t key;
+    int err;
+
+    key = k_spin_lock(&profile_lock);
+    record.addr = profile->addr;
+    record.params = profile->params;
+    record.map = profile->map;
+    k_spin_unlock(&profile_lock, key);
+
+    if (is_default(profile))
+    {
+        err = param_store_set(PARAM_STORE_HID, &record.params, sizeof(record.params));
+        if (!err)
+        {
+            err = param_store_set(PARAM_STORE_HID_MAP, &record.map, sizeof(record.map));
+        }
+        /* The change must win over the stored profile being loaded. */
+        default_pending = (err == -EAGAIN);
+    }
+    else
+    {
+        err = param_store_set(store_id(profile), &record, sizeof(record));
+    }
+    /* Before the store is loaded, the profile is stored by load_profiles. */
+    if (err && err != -ENOTSUP && err != -EAGAIN)
+    {
+        LOG_WRN("Profile not stored (%d)", err);
+    }
+}
+
+/**
+ * @brief Checks if a peer has been assigned one of the per-peer profiles
+ *
+ * @param addr Identity address of the peer
+ */
+static bool peer_has_profile(const bt_addr_le_t *addr)
+{
+    for (size_t i = 1; i < ARRAY_SIZE(profiles); i++)
+    {
+        if (!bt_addr_le_cmp(&profiles[i].addr, addr))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Replaces the parameters of the profiles with stored ones, if any,
+ *        once the parameter store is loaded
+ *
+ * A peer may have been assigned a profile before that. It keeps the profile,
+ * which is stored now, and a stored profile of the same peer is dropped.
+ * Likewise a default profile changed before that is kept and stored now.
+ */
+static void load_profiles(void)
+{
+    struct hid_tuning_params params;
+    struct hid_axis_map map;
+    struct profile_record record;
+    k_spinlock_key_t key;
+
+    if (profiles_loaded || !param_store_loaded())
+    {
+        return;
+    }
+    profiles_loaded = true;
+
+    if (default_pending)
+    {
+        store_profile(&profiles[0]);
+    }
+    else
+    {
+        if (!param_store_get(PARAM_STORE_HID, &params, sizeof(params)) &&
+            !validate_params(&params))
+        {
+            key = k_spin_lock(&profile_lock);
+            profiles[0].params = params;
+            k_spin_unlock(&profile_lock, key);
+            atomic_set(&profiles[0].changed, 1);
+        }
+        if (!param_store_get(PARAM_STORE_HID_MAP, &map, sizeof(map)) &&
+            !validate_map(&map))
+        {
+            key = k_spin_lock(&profile_lock);
+            profiles[0].map = map;
+            k_spin_unlock(&profile_lock, key);
+            atomic_set(&profiles[0].changed, 1);
+        }
+    }
+
+    for (size_t i = 1; i < ARRAY_SIZE(profiles); i++)
+    {
+        if (bt_addr_le_cmp(&profiles[i].addr, BT_ADDR_LE_ANY))
+        {
+            store_profile(&profiles[i]);
+            continue;
+        }
+        if (!param_store_get(store_id(&profiles[i]), &record, sizeof(record)) &&
+            !validate_params(&record.params) &&
+            !validate_map(&record.map) &&
+            !peer_has_profile(&record.addr))
+        {
+            key = k_spin_lock(&profile_lock);
+            profiles[i].addr = record.addr;
+            profiles[i].params = record.params;
+            profiles[i].map = record.map;
+            k_spin_unlock(&profile_lock, key);
+            atomic_set(&profiles[i].changed, 1);
+        }
+    }
+    LOG_INF("Stored profiles loaded");
+}
+
+void hid_profile_init(void)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(profiles); i++)
+    {
+        bt_addr_le_copy(&profiles[i].addr, BT_ADDR_LE_ANY);
+        profiles[i].params = default_params;
+        profiles[i].map = default_map;
+        profiles[i].last_used = 0;
+        profiles[i].connections = 0;
+        atomic_set(&profiles[i].changed, 1);
+    }
+    hid_profile_update();
+
+    LOG_INF("%d profiles, %u bytes of RAM each", ARRAY_SIZE(profiles), sizeof(struct hid_profile));
+}
+
+struct hid_profile *hid_profile_default(void)
+{
+    return &profiles[0];
+}
+
+struct hid_profile *hid_profile_for_peer(const bt_addr_le_t *addr)
+{
+    struct hid_profile *profile = NULL;
+    k_spinlock_key_t key;
+
+    if (ARRAY_SIZE(profiles) == 1)
+    {
+        return &profiles[0];
+    }
+
+    /* The stored profile of the peer may have been loaded meanwhile. */
+    load_profiles();
+
+    for (size_t i = 1; i < ARRAY_SIZE(profiles); i++)
+    {
+        if (!bt_addr_le_cmp(&profiles[i].addr, addr))
+        {
+            profile = &profiles[i];
+            break;
+        }
+    }
+
+    if (profile == NULL)
+    {
+        /* Take a free profile, or else the least recently used one, but
+         * never one that a connected peer is using.
+         */
+        for (size_t i = 1; i < ARRAY_SIZE(profiles); i++)
+        {
+            if (profiles[i].connections)
+            {
+                continue;
+            }
+            if (!bt_addr_le_cmp(&profiles[i].addr, BT_ADDR_LE_ANY))
+            {
+                profile = &profiles[i];
+                break;
+            }
+            if (!profile || (profiles[i].last_used < profile->last_used))
+            {
+                profile = &profiles[i];
+            }
+        }
+        if (profile == NULL)
+        {
+            LOG_WRN("All profiles in use, using the default profile");
+            return &profiles[0];
+        }
+
+        key = k_spin_lock(&profile_lock);
+        bt_addr_le_copy(&profile->addr, addr);
+        profile->params = profiles[0].params;
+        profile->map = profiles[0].map;
+        k_spin_unlock(&profile_lock, key);
+        atomic_set(&profile->changed, 1);
+        store_profile(profile);
+        LOG_INF("Assigned profile %d to new peer", profile - &profiles[1]);
+    }
+
+    profile->last_used = ++use_counter;
+    profile->connections++;
+    return profile;
+}
+
+void hid_profile_release(struct hid_profile *profile)
+{
+    if (!is_default(profile) && profile->connections)
+    {
+        profile->connections--;
+    }
+}
+
+/**
+ * @brief Returns a per-peer profile to the defaults, unassigned, and stores it
+ *
+ * @param profile Profile to clear
+ */
+static void clear_profile(struct hid_profile *profile)
+{
+    k_spinlock_key_t key = k_spin_lock(&profile_lock);
+
+    bt_addr_le_copy(&profile->addr, BT_ADDR_LE_ANY);
+    profile->params = default_params;
+    profile->map = default_map;
+    k_spin_unlock(&profile_lock, key);
+    profile->last_used = 0;
+    /* Its peers are moved to the default profile. */
+    profile->connections = 0;
+    atomic_set(&profile->changed, 1);
+    store_profile(profile);
+}
+
+struct hid_profile *hid_profile_remove_peer(const bt_addr_le_t *addr)
+{
+    /* A stored profile of the peer must not be loaded afterwards. */
+    load_profiles();
+
+    for (size_t i = 1; i < ARRAY_SIZE(profiles); i++)
+    {
+        if (!bt_addr_le_cmp(&profiles[i].addr, addr))
+        {
+            clear_profile(&profiles[i]);
+            LOG_INF("Profile %d of removed peer cleared", (int)(i - 1));
+            return &profiles[i];
+        }
+    }
+    return NULL;
+}
+
+void hid_profile_remove_all(void)
+{
+    load_profiles();
+
+    for (size_t i = 1; i < ARRAY_SIZE(profiles); i++)
+    {
+        if (bt_addr_le_cmp(&profiles[i].addr, BT_ADDR_LE_ANY))
+        {
+            clear_profile(&profiles[i]);
+        }
+    }
+    LOG_INF("Peer profiles cleared");
+}
+
+void hid_profile_params_get(const struct hid_profile *profile, struct hid_tuning_params *params)
+{
+    k_spinlock_key_t key = k_spin_lock(&profile_lock);
+
+    *params = profile->params;
+    k_spin_unlock(&profile_lock, key);
+}
+
+int hid_profile_params_set(struct hid_profile *profile, const struct hid_tuning_params *params)
+{
+    k_spinlock_key_t key;
+
+    if (validate_params(params))
+    {
+        return -EINVAL;
+    }
+
+    key = k_spin_lock(&profile_lock);
+    profile->params = *params;
+    k_spin_unlock(&profile_lock, key);
+    atomic_set(&profile->changed, 1);
+
+    store_profile(profile);
+    return 0;
+}
+
+void hid_profile_map_get(const struct hid_profile *profile, struct hid_axis_map *map)
+{
+    k_spinlock_key_t key = k_spin_lock(&profile_lock);
+
+    *map = profile->map;
+    k_spin_unlock(&profile_lock, key);
+}
+
+int hid_profile_map_set(struct hid_profile *profile, const struct hid_axis_map *map)
+{
+    k_spinlock_key_t key;
+
+    if (validate_map(map))
+    {
+        return -EINVAL;
+    }
+
+    key = k_spin_lock(&profile_lock);
+    profile->map = *map;
+    k_spin_unlock(&profile_lock, key);
+    atomic_set(&profile->changed, 1);
+
+    store_profile(profile);
+    return 0;
+}
+
+/**
+ * @brief Reads the encoder sample period, marking every profile as changed
+ *        if it differs from the one the coefficients were computed with
+ */
+static void update_sample_period(void)
+{
+    struct encoder_params enc_params = ENCODER_PARAMS_DEFAULT;
+    uint32_t generation = param_store_generation(PARAM_STORE_ENCODER);
+
+    if (generation == encoder_generation && sample_period_s > 0.0f)
+    {
+        return;
+    }
+    encoder_generation = generation;
+
+    /* Defaults apply until parameters have been stored. */
+    param_store_get(PARAM_STORE_ENCODER, &enc_params, sizeof(enc_params));
+    sample_period_s = (float)enc_params.delta_time_msec / 1000.0f;
+
+    for (size_t i = 0; i < ARRAY_SIZE(profiles); i++)
+    {
+        atomic_set(&profiles[i].changed, 1);
+    }
+}
+
+void hid_profile_update(void)
+{
+    struct hid_tuning_params params;
+    struct hid_axis_map map;
+
+    load_profiles();
+    update_sample_period();
+
+    for (size_t i = 0; i < ARRAY_SIZE(profiles); i++)
+    {
+        if (!atomic_cas(&profiles[i].changed, 1, 0))
+        {
+            continue;
+        }
+        hid_profile_params_get(&profiles[i], &params);
+        hid_profile_map_get(&profiles[i], &map);
+        compute_coeffs(&params, &map, &profiles[i].coeffs);
+    }
+}
@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _HID_PROFILE_H_
+#define _HID_PROFILE_H_
+
+/**@file
+ *@brief HID user profiles.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/addr.h>
+
+#include "axis_filter.h"
+#include "predictor.h"
+#include "dead_reckoning.h"
+
+/**
+ * @defgroup hid_profile HID user profiles
+ * @{
+ * @brief Tuning parameters of the HID module, kept per bonded peer.
+ *
+ * Every profile caches the coefficients derived from its parameters, so
+ * switching profile is a pointer swap. The default profile is used for
+ * USB and for peers without a profile of their own.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Signals that can be placed on a joystick axis. */
+enum hid_signal {
+	/** Always neutral. */
+	HID_SIGNAL_ZERO,
+	/** Translational speed of the player. */
+	HID_SIGNAL_TRANSLATION,
+	/** Turn rate of the player, after sensitivity and slow start. */
+	HID_SIGNAL_TURN,
+	/** Surface speed of the left-hand rollers. */
+	HID_SIGNAL_LEFT_WHEEL,
+	/** Surface speed of the right-hand rollers. */
+	HID_SIGNAL_RIGHT_WHEEL,
+
+	HID_SIGNAL_COUNT,
+};
+
+/** @brief Joystick axes of the input report, in report order. */
+enum hid_axis {
+	HID_AXIS_X,
+	HID_AXIS_Y,
+	HID_AXIS_Z,
+	HID_AXIS_RZ,
+
+	HID_AXIS_COUNT,
+};
+
+/**
+ * @brief Runtime-tunable parameters of the wheelchair model and the HID mapping.
+ *        This is also the layout of the tuning feature report (see hid_report_desc.c),
+ *        with all fields in little endian.
+ */
+struct hid_tuning_params {
+	/* Translational speed that maps to full joystick deflection [mm/s] */
+	uint16_t max_speed_mm_per_sec;
+	/* Turn rate that maps to full joystick deflection [deg/s] */
+	uint16_t max_turn_rate_deg_per_sec;
+	/* Speed where turning sensitivity starts to drop [permille of max speed] */
+	uint16_t sensitivity_start_permille;
+	/* Speed where turning sensitivity reaches its minimum [permille of max speed] */
+	uint16_t sensitivity_end_permille;
+	/* IIR coefficient of turning sensitivity vs translational speed [permille] */
+	uint16_t sensitivity_alpha_permille;
+	/* Multiplier applied to the turning rate prior to clamping [permille] */
+	uint16_t turn_scaling_permille;
+	/* Diameter of the ergometer cylinders [mm] */
+	uint16_t cylinder_diameter_mm;
+	/* Distance between the wheelchair wheels [mm] */
+	uint16_t inter_wheel_distance_mm;
+} __packed;
+
+/** @brief Mapping of one joystick axis. */
+struct hid_axis_config {
+	/* Signal shown on the axis, see @ref hid_signal */
+	uint8_t signal;
+	/* Non-zero to invert the axis */
+	uint8_t invert;
+	/* Response curve, 0 is linear and 1000 is fully cubic [permille] */
+	uint16_t expo_permille;
+	/* Output filter chain, run on the signal before the response curve */
+	struct axis_filter_config filter;
+} __packed;
+
+/**
+ * @brief Mapping of signals to joystick axes.
+ *        This is also the layout of the axis mapping feature report (see hid_report_desc.c).
+ */
+struct hid_axis_map {
+	struct hid_axis_config axes[HID_AXIS_COUNT];
+} __packed;
+
+/** @brief Precomputed mapping of one joystick axis, y = linear*x + cubic*x^3. */
+struct hid_axis_coeffs {
+	enum hid_signal signal;
+	float linear;
+	float cubic;
+	struct axis_filter_coeffs filter;
+};
+
+/**
+ * @brief Coefficients derived from @ref hid_tuning_params.
+ *        Recomputed once when the parameters change, never per sample.
+ */
+struct hid_coeffs {
+	/* The radius [m] of one of the cylinders of the ergometer */
+	float r_c;
+	/* Half of the distance [m] between the wheelchair wheels */
+	float r_p;
+	float max_translational_speed_m_per_sec;
+	float max_turn_rate_deg_per_sec;
+	/* Absolute speeds [m/s] of the turning sensitivity ramp */
+	float sensitivity_start_m_per_sec;
+	float sensitivity_end_m_per_sec;
+	/* Slope of the turning sensitivity ramp [1/(m/s)] */
+	float sensitivity_slope;
+	/* y[t]=alpha*y[t-1]+(1-alpha)*x[t] */
+	float sensitivity_alpha;
+	/* Turn scaling, including the conversion from rad/s to deg/s */
+	float turn_scaling_deg;
+	/* Scale factors from [-max, max] to [-1, 1] */
+	float translation_norm;
+	float turn_norm;
+	struct hid_axis_coeffs axes[HID_AXIS_COUNT];
+	/* Latency compensation, applied to every axis after its filter chain */
+	struct predictor_coeffs predictor;
+	/* Geometry used for odometry */
+	struct dead_reckoning_geometry geometry;
+};
+
+/** @brief A user profile. */
+struct hid_profile {
+	/* Identity address of the bonded peer, BT_ADDR_LE_ANY if unassigned. */
+	bt_addr_le_t addr;
+	/* Incremented on each activation, used to recycle the least recently used profile. */
+	uint32_t last_used;
+	/* Connected peers using the profile, which is then never recycled. */
+	uint8_t connections;
+	/* Set when params has changed and coeffs must be recomputed. */
+	atomic_t changed;
+	/* Written from the Bluetooth and USB contexts, protected by a lock. */
+	struct hid_tuning_params params;
+	struct hid_axis_map map;
+	/* Only accessed from the HID module event handler context. */
+	struct hid_coeffs coeffs;
+};
+
+/* Turning sensitivity at and below sensitivity_start */
+#define HID_SENSITIVITY_MAX 1.0f
+/* Turning sensitivity at and above sensitivity_end */
+#define HID_SENSITIVITY_MIN 0.6f
+
+/** @brief Set up the profiles with the defaults and compute their coefficients.
+ *
+ *  The stored profiles replace the defaults in @ref hid_profile_update once
+ *  the parameter store is loaded.
+ */
+void hid_profile_init(void);
+
+/** @brief Get the default profile.
+ *
+ *  @return Default profile.
+ */
+struct hid_profile *hid_profile_default(void);
+
+/** @brief Get the profile of a connected bonded peer, assigning one if it has none.
+ *
+ *  When all profiles are taken, the least recently used one that no
+ *  connected peer uses is reassigned, starting from the parameters and
+ *  mapping of the default profile. If every profile is in use, the peer
+ *  gets the default profile.
+ *
+ *  Must be paired with @ref hid_profile_release when the peer disconnects.
+ *
+ *  @param[in] addr Identity address of the peer.
+ *
+ *  @return Profile of the peer.
+ */
+struct hid_profile *hid_profile_for_peer(const bt_addr_le_t *addr);
+
+/** @brief Release the profile of a peer that disconnected.
+ *
+ *  @param[in] profile Profile returned by @ref hid_profile_for_peer.
+ */
+void hid_profile_release(struct hid_profile *profile);
+
+/** @brief Clear the profile of a peer whose bond was removed.
+ *
+ *  The profile goes back to the defaults and is free for a new peer. A
+ *  connected peer that used it must be moved to the default profile.
+ *
+ *  @param[in] addr Identity address of the peer.
+ *
+ *  @return Cleared profile, or NULL if the peer had none.
+ */
+struct hid_profile *hid_profile_remove_peer(const bt_addr_le_t *addr);
+
+/** @brief Clear the profiles of all peers, when every bond was erased.
+ *
+ *  The default profile is kept.
+ */
+void hid_profile_remove_all(void);
+
+/** @brief Copy the parameters of a profile.
+ *
+ *  @param[in] profile Profile.
+ *  @param[out] params Parameters.
+ */
+void hid_profile_params_get(const struct hid_profile *profile, struct hid_tuning_params *params);
+
+/** @brief Validate and apply new parameters to a profile, and schedule them for storage.
+ *
+ *  @param[in] profile Profile.
+ *  @param[in] params New parameters.
+ *
+ *  @return 0 if successful, -EINVAL if the parameters are invalid.
+ */
+int hid_profile_params_set(struct hid_profile *profile, const struct hid_tuning_params *params);
+
+/** @brief Copy the axis mapping of a profile.
+ *
+ *  @param[in] profile Profile.
+ *  @param[out] map Axis mapping.
+ */
+void hid_profile_map_get(const struct hid_profile *profile, struct hid_axis_map *map);
+
+/** @brief Validate and apply a new axis mapping to a profile, and schedule it for storage.
+ *
+ *  @param[in] profile Profile.
+ *  @param[in] map New axis mapping.
+ *
+ *  @return 0 if successful, -EINVAL if the mapping is invalid.
+ */
+int hid_profile_map_set(struct hid_profile *profile, const struct hid_axis_map *map);
+
+/** @brief Recompute the coefficients of every profile whose parameters changed.
+ *
+ *  Applies the stored profiles once the parameter store is loaded. The
+ *  coefficients of the output filters also depend on the encoder sample
+ *  period, so every profile is recomputed when the encoder parameters change.
+ *
+ *  Must be called from the context that reads @ref hid_profile.coeffs.
+ */
+void hid_profile_update(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* _HID_PROFILE_H_ */
@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/init.h>
+#include <zephyr/usb/usb_device.h>
+#include <zephyr/usb/class/usb_hid.h>
+
+#include "hid_report_desc.h"
+#include "hid_usb.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(hid_usb, CONFIG_HID_MODULE_LOG_LEVEL);
+
+/* Report ID byte followed by the largest input report. */
+#define REPORT_BUFFER_SIZE 16
+/* Report ID byte followed by the largest feature report. */
+#define FEATURE_BUFFER_SIZE 65
+
+/* Report type in the high byte of wValue of GET_REPORT/SET_REPORT. */
+#define REPORT_TYPE_FEATURE 0x03
+
+static const struct device *hid_dev;
+
+static bool usb_configured;
+static bool usb_suspended;
+
+/* Protects the pending report and the endpoint state. */
+static K_MUTEX_DEFINE(report_mutex);
+static uint8_t pending_report[REPORT_BUFFER_SIZE];
+static size_t pending_len;
+static bool ep_busy;
+
+/* Only written by the context that set ep_busy. */
+static uint8_t tx_report[REPORT_BUFFER_SIZE];
+static size_t tx_len;
+
+/**
+ * @brief Take the pending report for transmission, or mark the endpoint idle.
+ *        Must be called with report_mutex held.
+ *
+ * @return true if tx_report holds a report that must be written
+ */
+static bool take_pending_report(void)
+{
+    if (pending_len == 0)
+    {
+        ep_busy = false;
+        return false;
+    }
+    memcpy(tx_report, pending_report, pending_len);
+    tx_len = pending_len;
+    pending_len = 0;
+    ep_busy = true;
+    return true;
+}
+
+static void write_tx_report(void)
+{
+    int err = hid_int_ep_write(hid_dev, tx_report, tx_len, NULL);
+
+    if (err)
+    {
+        LOG_ERR("Cannot write USB HID report (%d)", err);
+        k_mutex_lock(&report_mutex, K_FOREVER);
+        ep_busy = false;
+        k_mutex_unlock(&report_mutex);
+    }
+}
+
+/**
+ * @brief Called when the host has read the previous report from the
+ *        interrupt endpoint. This paces the transport at the host polling interval.
+ *
+ * @param dev USB HID device
+ */
+static void int_in_ready_cb(const struct device *dev)
+{
+    bool write;
+
+    k_mutex_lock(&report_mutex, K_FOREVER);
+    write = take_pending_report();
+    k_mutex_unlock(&report_mutex);
+
+    if (write)
+    {
+        write_tx_report();
+    }
+}
+
+static const struct hid_usb_feature_cb *feature_cb;
+static uint8_t feature_report[FEATURE_BUFFER_SIZE];
+
+static int get_report_cb(const struct device *dev, struct usb_setup_packet *setup,
+                         int32_t *len, uint8_t **data)
+{
+    uint8_t report_type = setup->wValue >> 8;
+    uint8_t report_id = setup->wValue & 0xFF;
+    int ret;
+
+    if (report_type != REPORT_TYPE_FEATURE || feature_cb == NULL)
+    {
+        return -ENOTSUP;
+    }
+
+    ret = feature_cb->get(report_id, &feature_report[1], sizeof(feature_report) - 1);
+    if (ret < 0)
+    {
+        return ret;
+    }
+    feature_report[0] = report_id;
+    *len = ret + 1;
+    *data = feature_report;
+    return 0;
+}
+
+static int set_report_cb(const struct device *dev, struct usb_setup_packet *setup,
+                         int32_t *len, uint8_t **data)
+{
+    uint8_t report_type = setup->wValue >> 8;
+    uint8_t report_id = setup->wValue & 0xFF;
+
+    if (report_type != REPORT_TYPE_FEATURE || feature_cb == NULL || *len < 1)
+    {
+        return -ENOTSUP;
+    }
+
+    /* The first byte of the data stage is the report ID. */
+    return feature_cb->set(report_id, &(*data)[1], *len - 1);
+}
+
+static const struct hid_ops ops = {
+    .get_report = get_report_cb,
+    .set_report = set_report_cb,
+    .int_in_ready = int_in_ready_cb,
+};
+
+static void (*state_cb)(bool active);
+
+static void status_cb(enum usb_dc_status_code status, const uint8_t *param)
+{
+    bool was_active = hid_usb_is_active();
+
+    switch (status)
+    {
+    case USB_DC_CONFIGURED:
+        k_mutex_lock(&report_mutex, K_FOREVER);
+        ep_busy = false;
+        pending_len = 0;
+        k_mutex_unlock(&report_mutex);
+        usb_configured = true;
+        usb_suspended = false;
+        LOG_INF("USB configured, sending reports over USB");
+        break;
+
+    case USB_DC_SUSPEND:
+        usb_suspended = true;
+        break;
+
+    case USB_DC_RESUME:
+        usb_suspended = false;
+        break;
+
+    case USB_DC_RESET:
+    case USB_DC_DISCONNECTED:
+        if (usb_configured)
+        {
+            LOG_INF("USB disconnected, sending reports over Bluetooth");
+        }
+        usb_configured = false;
+        break;
+
+    default:
+        /* No action */
+        break;
+    }
+
+    if ((state_cb != NULL) && (hid_usb_is_active() != was_active))
+    {
+        state_cb(hid_usb_is_active());
+    }
+}
+
+void hid_usb_set_state_cb(void (*cb)(bool active))
+{
+    state_cb = cb;
+}
+
+void hid_usb_set_feature_cb(const struct hid_usb_feature_cb *cb)
+{
+    feature_cb = cb;
+}
+
+bool hid_usb_is_active(void)
+{
+    return usb_configured && !usb_suspended;
+}
+
+int hid_usb_send(uint8_t report_id, const uint8_t *data, size_t len)
+{
+    bool write;
+
+    if (!hid_usb_is_active())
+    {
+        return -ENOTCONN;
+    }
+    if (len + 1 > REPORT_BUFFER_SIZE)
+    {
+        return -EMSGSIZE;
+    }
+
+    k_mutex_lock(&report_mutex, K_FOREVER);
+    pending_report[0] = report_id;
+    memcpy(&pending_report[1], data, len);
+    pending_len = len + 1;
+    write = !ep_busy && take_pending_report();
+    k_mutex_unlock(&report_mutex);
+
+    if (write)
+    {
+        write_tx_report();
+    }
+    return 0;
+}
+
+static int hid_usb_init(const struct device *unused)
+{
+    int err;
+
+    ARG_UNUSED(unused);
+
+    hid_dev = device_get_binding("HID_0");
+    if (hid_dev == NULL)
+    {
+        LOG_ERR("Cannot get USB HID device");
+        return -ENODEV;
+    }
+
+    usb_hid_register_device(hid_dev, hid_report_desc, hid_report_desc_size, &ops);
+
+    err = usb_hid_init(hid_dev);
+    if (err)
+    {
+        LOG_ERR("Failed to initialize USB HID (%d)", err);
+        return err;
+    }
+
+    err = usb_enable(status_cb);
+    if (err)
+    {
+        LOG_ERR("Failed to enable USB (%d)", err);
+        return err;
+    }
+    return 0;
+}
+
+SYS_INIT(hid_usb_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _HID_USB_H_
+#define _HID_USB_H_
+
+/**@file
+ *@brief USB transport for the HID module.
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <zephyr/types.h>
+#include <zephyr/sys/util.h>
+
+/**
+ * @defgroup hid_usb USB HID transport
+ * @{
+ * @brief Sends the reports built by the HID module over USB.
+ *
+ * The transport registers the same report descriptor as the Bluetooth HID
+ * service. Reports are written to the interrupt IN endpoint whenever the
+ * host has polled the previous one, so the report rate follows the host
+ * polling interval.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Callbacks for feature reports requested by the USB host. */
+struct hid_usb_feature_cb {
+	/** Fill @p data with the feature report, return its length or a negative error code. */
+	int (*get)(uint8_t report_id, uint8_t *data, size_t len);
+	/** Apply a feature report written by the host, return 0 or a negative error code. */
+	int (*set)(uint8_t report_id, const uint8_t *data, size_t len);
+};
+
+#if IS_ENABLED(CONFIG_HID_MODULE_USB)
+
+/** @brief Register the handlers of feature reports.
+ *
+ *  @param[in] cb Feature report callbacks. Must remain valid.
+ */
+void hid_usb_set_feature_cb(const struct hid_usb_feature_cb *cb);
+
+/** @brief Register a handler called when hid_usb_is_active() changes.
+ *
+ *  The handler runs in the context of the USB device stack and must not
+ *  block.
+ *
+ *  @param[in] cb Handler, or NULL to remove it.
+ */
+void hid_usb_set_state_cb(void (*cb)(bool active));
+
+/** @brief Check if the device is enumerated and configured by a USB host.
+ *
+ *  @return true if reports should be sent over USB.
+ */
+bool hid_usb_is_active(void);
+
+/** @brief Submit an input report for transmission over USB.
+ *
+ *  If the previous report has not been read by the host yet, the new
+ *  report replaces any report waiting to be sent.
+ *
+ *  @param[in] report_id Report ID of the input report.
+ *  @param[in] data Report data, without the report ID.
+ *  @param[in] len Length of the report data.
+ *
+ *  @return 0 if successful, otherwise a negative error code.
+ */
+int hid_usb_send(uint8_t report_id, const uint8_t *data, size_t len);
+
+#else
+
+static inline void hid_usb_set_feature_cb(const struct hid_usb_feature_cb *cb) {}
+static inline void hid_usb_set_state_cb(void (*cb)(bool active)) {}
+static inline bool hid_usb_is_active(void) { return false; }
+static inline int hid_usb_send(uint8_t report_id, const uint8_t *data, size_t len)
+{
+	return -ENOTSUP;
+}
+
+#endif /* IS_ENABLED(CONFIG_HID_MODULE_USB) */
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* _HID_USB_H_ */
@@ -15,7 +15,6 @@
 #include <drivers/sensor.h>
 #include <drivers/led_strip.h>
 #include <drivers/spi.h>
-#include "modules_common.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(MODULE, CONFIG_LED_MODULE_LOG_LEVEL);
@@ -42,187 +41,266 @@ static const struct led_rgb colors[] = {
 enum blink_type_index {
 	ACTIVE,
 	BACKGROUND,
+	BLINK_TYPE_COUNT,
 };
 
 #define SHORT_BLINK		CONFIG_LED_MODULE_BLINK_DURATION_SHORT_MSEC
 #define MEDIUM_BLINK	CONFIG_LED_MODULE_BLINK_DURATION_MEDIUM_MSEC
 #define LONG_BLINK		CONFIG_LED_MODULE_BLINK_DURATION_LONG_MSEC
 
-/* LED module message queue. */
-#define LED_QUEUE_ENTRY_COUNT		20
-#define LED_QUEUE_BYTE_ALIGNMENT	4
+/**
+ * @brief A blink pattern: the LED is lit in one color for on_msec, then
+ * 		dark for half of that, num_blinks times.
+ */
+struct led_pattern {
+	uint16_t on_msec;
+	uint8_t color;
+	uint8_t num_blinks;
+};
 
-struct led_msg_data {
-	int num_blinks;
-	int blink_duration_msec;
-	led_color_t blink_color;
-	int blink_type;
+enum led_pattern_id {
+	PATTERN_NONE,
+	PATTERN_BOOT,
+	PATTERN_CONNECTED,
+	PATTERN_SECURED,
+	PATTERN_DISCONNECTED,
+	PATTERN_CONN_FAILED,
+	PATTERN_SEARCHING,
 };
 
+static const struct led_pattern patterns[] = {
+	[PATTERN_NONE]		= { .on_msec = 0,		.color = BLACK,		.num_blinks = 0,	},
+	[PATTERN_BOOT]		= { .on_msec = LONG_BLINK,	.color = GREEN,		.num_blinks = 1,	},
+	[PATTERN_CONNECTED]	= { .on_msec = MEDIUM_BLINK,	.color = ORANGE,	.num_blinks = 2,	},
+	[PATTERN_SECURED]	= { .on_msec = MEDIUM_BLINK,	.color = GREEN,		.num_blinks = 2,	},
+	[PATTERN_DISCONNECTED]	= { .on_msec = SHORT_BLINK,	.color = RED,		.num_blinks = 2,	},
+	[PATTERN_CONN_FAILED]	= { .on_msec = MEDIUM_BLINK,	.color = RED,		.num_blinks = 5,	},
+	[PATTERN_SEARCHING]	= { .on_msec = LONG_BLINK,	.color = BLUE,		.num_blinks = 10,	},
+};
 
-K_MSGQ_DEFINE(msgq_led, sizeof(struct led_msg_data),
-	      LED_QUEUE_ENTRY_COUNT, LED_QUEUE_BYTE_ALIGNMENT);
+BUILD_ASSERT(LONG_BLINK <= UINT16_MAX, "Blink durations must fit 16 bits");
 
-static struct module_data self = {
-	.name = "led",
-	.msg_q = &msgq_led,
-	.supports_shutdown = true
+/**
+ * @brief Playback state of one priority layer. The highest layer with a
+ * 		pattern is shown, lower layers resume from the start of the
+ * 		interrupted blink. Only accessed from the system work queue,
+ * 		which also runs the event handlers.
+ */
+struct led_layer {
+	uint8_t pattern;
+	uint8_t remaining_blinks;
+	bool lit;
 };
 
+static struct led_layer layers[BLINK_TYPE_COUNT];
+static int shown_layer = -1;
+
+static void led_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(led_work, led_work_handler);
+
 static const struct device* led_dev = DEVICE_DT_GET_ANY(apa_apa102);
 
-void set_light_color(led_color_t color)
+/* Color currently on the strip, -1 when unknown. */
+static int shown_color = -1;
+
+/* Color of a write refused while the bus was busy, -1 when none. */
+static int pending_color = -1;
+
+static void led_retry_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(led_retry_work, led_retry_work_handler);
+
+static struct {
+	uint32_t writes;
+	uint32_t skipped;
+	uint32_t busy;
+} led_stats;
+
+#if defined(CONFIG_LED_MODULE_SPI_ASYNC)
+#define APA102_NODE	DT_COMPAT_GET_ANY_STATUS_OKAY(apa_apa102)
+
+static const struct spi_dt_spec led_spi = SPI_DT_SPEC_GET(APA102_NODE,
+	SPI_OP_MODE_MASTER | SPI_TRANSFER_MSB | SPI_WORD_SET(8), 0);
+
+/* Start frame, one LED frame (brightness, blue, green, red) and end frame,
+ * laid out the same way as the APA102 strip driver. Must stay untouched
+ * while a transfer is in flight.
+ */
+static uint8_t led_frame[12] = {
+	0x00, 0x00, 0x00, 0x00,
+	0xFF, 0x00, 0x00, 0x00,
+	0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+static struct k_poll_signal spi_done = K_POLL_SIGNAL_INITIALIZER(spi_done);
+static bool spi_in_flight;
+
+/**
+ * @brief Starts the transfer of one LED frame without waiting for it.
+ *
+ * @return 0 if the transfer started, -EBUSY if the previous frame is still
+ *         being sent, otherwise a negative error code of the SPI driver
+ */
+static int led_write(const struct led_rgb *rgb)
 {
-	struct led_rgb cols[1] = {
-		colors[color],
+	if (spi_in_flight)
+	{
+		unsigned int signaled;
+		int result;
+
+		k_poll_signal_check(&spi_done, &signaled, &result);
+		if (!signaled)
+		{
+			/* The controller still reads led_frame. */
+			return -EBUSY;
+		}
+		spi_in_flight = false;
+	}
+
+	led_frame[5] = rgb->b;
+	led_frame[6] = rgb->g;
+	led_frame[7] = rgb->r;
+
+	const struct spi_buf buf = {
+		.buf = led_frame,
+		.len = sizeof(led_frame),
+	};
+	const struct spi_buf_set tx = {
+		.buffers = &buf,
+		.count = 1,
 	};
-	led_strip_update_rgb(led_dev, cols, 1);
-}
 
-void led_blink_once(int blink_length_msec, led_color_t color)
+	k_poll_signal_reset(&spi_done);
+	int err = spi_transceive_async(led_spi.bus, &led_spi.config, &tx, NULL,
+				       &spi_done);
+	if (!err)
+	{
+		spi_in_flight = true;
+	}
+	return err;
+}
+#else
+static int led_write(const struct led_rgb *rgb)
 {
-	set_light_color(color);
-	k_sleep(K_MSEC(blink_length_msec));
-	set_light_color(BLACK);
-	k_sleep(K_MSEC((int)(blink_length_msec/2.0)));
+	struct led_rgb cols[1] = {
+		*rgb,
+	};
+	return led_strip_update_rgb(led_dev, cols, 1);
 }
+#endif /* CONFIG_LED_MODULE_SPI_ASYNC */
 
 /**
- * @brief Blink the LED with a number of repeats, length and color-
- * 		The black period is always half the length of the blink length.
- * 
- * @param num_blinks Number of times to blink the LED
- * @param blink_length_msec msec the LED should blink
- * @param color color to blink the LED
+ * @brief Sets the LED color. Skips the bus transfer if the strip already
+ * 		shows that color.
  */
-void led_blink(int num_blinks, int blink_length_msec, led_color_t color)
+void set_light_color(led_color_t color)
 {
-	for (int i = 0; i < num_blinks; i++)
+	if (shown_color == color)
 	{
-		set_light_color(color);
-		k_sleep(K_MSEC(blink_length_msec));
-		set_light_color(BLACK);
-		k_sleep(K_MSEC((int)(blink_length_msec/2.0)));
+		led_stats.skipped++;
+		return;
 	}
-	return;
-}
 
-/*================= EVENT HANDLERS =================*/
+	int err = led_write(&colors[color]);
 
-/**
- * @brief Mapping for blinking Bluetooth peer events
- * 
- * @param event bluetooth peer event
- * @return struct led_msg_data color, number of blinks and length to blink
- */
-static struct led_msg_data blink_data_from_peer_event(const struct ble_peer_event *event)
-{
-	struct led_msg_data blink_data;
-	blink_data.blink_type = ACTIVE;
-	switch (event->state)
+	if (err == -EBUSY)
 	{
-		case PEER_STATE_DISCONNECTED:
-			blink_data.blink_color = RED;
-			blink_data.num_blinks = 2;
-			blink_data.blink_duration_msec = SHORT_BLINK;
-			break;
-		case PEER_STATE_CONNECTED:
-			blink_data.blink_color = ORANGE;
-			blink_data.num_blinks = 2;
-			blink_data.blink_duration_msec = MEDIUM_BLINK;
-			break;
-		case PEER_STATE_SECURED:
-			blink_data.blink_color = GREEN;
-			blink_data.num_blinks = 2;
-			blink_data.blink_duration_msec = MEDIUM_BLINK;
-			break;
-		case PEER_STATE_CONN_FAILED:
-			blink_data.blink_color = RED;
-			blink_data.num_blinks = 5;
-			blink_data.blink_duration_msec = MEDIUM_BLINK;
-			break;
-		default:
-			blink_data.blink_color = BLACK;
-			blink_data.num_blinks = 0;
-			blink_data.blink_duration_msec = 0;
-			break;
+		/* Retried shortly, unless the next step writes first. */
+		led_stats.busy++;
+		shown_color = -1;
+		pending_color = color;
+		k_work_schedule(&led_retry_work, K_MSEC(1));
+		return;
 	}
-	return blink_data;
+	if (err)
+	{
+		LOG_WRN("LED update failed, err %d", err);
+		shown_color = -1;
+		return;
+	}
+	shown_color = color;
+	pending_color = -1;
+	led_stats.writes++;
 }
 
-/**
- * @brief Mapping for bluetooth search events and blinking
- *
- * @param event CAF ble peer search event
- * @return struct led_msg_data color, number of blinks and length to blink
- */
-static struct led_msg_data blink_data_from_peer_search_event(const struct ble_peer_search_event *event)
+static void led_retry_work_handler(struct k_work *work)
 {
-	struct led_msg_data blink_data;
-	blink_data.blink_type = BACKGROUND;
-	if (event->active)
+	if (pending_color >= 0)
 	{
-		blink_data.blink_color = BLUE;
-		blink_data.num_blinks = 10;
-		blink_data.blink_duration_msec = LONG_BLINK;
-	} else {
-		blink_data.blink_color = BLACK;
-		blink_data.num_blinks = 0;
-		blink_data.blink_duration_msec = 0;
+		set_light_color(pending_color);
 	}
-	return blink_data;
 }
 
 /**
- * @brief Main event handler for module
- * 
- * @param aeh one of the subscribed events
- * @return true the event is consumed
- * @return false the event is not consumed (default)
+ * @brief Advances the pattern of the highest active layer by one step and
+ * 		schedules the next step.
  */
-static bool app_event_handler(const struct app_event_header *aeh)
+static void led_work_handler(struct k_work *work)
 {
-	struct led_msg_data msg = {0};
-	bool enqueue_msg = false;
+	int top = -1;
 
-	if (is_ble_peer_event(aeh))
+	for (int i = 0; i < BLINK_TYPE_COUNT; i++)
 	{
-		msg = blink_data_from_peer_event(cast_ble_peer_event(aeh));
-		enqueue_msg = true;
+		if (layers[i].pattern != PATTERN_NONE)
+		{
+			top = i;
+			break;
+		}
 	}
-	if (is_ble_peer_search_event(aeh))
+
+	if (top != shown_layer && shown_layer >= 0)
 	{
-		msg = blink_data_from_peer_search_event( cast_ble_peer_search_event(aeh));
-		enqueue_msg = true;
+		/* Preempted mid-blink, restart that blink when resumed. */
+		layers[shown_layer].lit = false;
 	}
+	shown_layer = top;
 
-	if (is_module_state_event(aeh)) {
-		const struct module_state_event *event = cast_module_state_event(aeh);
-
-		if (check_state(event, MODULE_ID(main), MODULE_STATE_READY)) {
-			/* No setup necessary since it is done in module_thread_fn */
-			module_set_state(MODULE_STATE_READY);
-		}
-		return false;
+	if (top < 0)
+	{
+		set_light_color(BLACK);
+		LOG_DBG("LED idle, %u writes, %u skipped, %u busy",
+			led_stats.writes, led_stats.skipped, led_stats.busy);
+		return;
 	}
 
-	if (enqueue_msg) {
-		int err = module_enqueue_msg(&self, &msg);
+	struct led_layer *layer = &layers[top];
+	const struct led_pattern *pattern = &patterns[layer->pattern];
 
-		if (err) {
-			LOG_ERR("Message could not be enqueued");
-		}
-		return false;
+	if (!layer->lit)
+	{
+		set_light_color(pattern->color);
+		layer->lit = true;
+		k_work_reschedule(&led_work, K_MSEC(pattern->on_msec));
+		return;
 	}
 
-
-	/* Event not handled but subscribed. */
-	__ASSERT_NO_MSG(false);
-	return false;
+	set_light_color(BLACK);
+	layer->lit = false;
+	if (--layer->remaining_blinks == 0)
+	{
+		layer->pattern = PATTERN_NONE;
+	}
+	k_work_reschedule(&led_work, K_MSEC(pattern->on_msec / 2));
 }
 
+/**
+ * @brief Starts a pattern on a layer. A pattern on the shown layer or a
+ * 		higher one takes effect at once.
+ *
+ * @param type Layer of the pattern
+ * @param pattern Pattern to play, PATTERN_NONE to clear the layer
+ */
+static void led_play(enum blink_type_index type, enum led_pattern_id pattern)
+{
+	layers[type].pattern = patterns[pattern].num_blinks ? pattern : PATTERN_NONE;
+	layers[type].remaining_blinks = patterns[pattern].num_blinks;
+	layers[type].lit = false;
+
+	if (shown_layer < 0 || (int)type <= shown_layer)
+	{
+		k_work_reschedule(&led_work, K_NO_WAIT);
+	}
+}
 
-/*================= MODULE THREAD =================*/
 static int setup(void)
 {
 	if (!led_dev) {
@@ -234,57 +312,92 @@ static int setup(void)
 		LOG_ERR("LED Device not ready");
 		return -ENODEV;
 	}
+#if defined(CONFIG_LED_MODULE_SPI_ASYNC)
+	if (!spi_is_ready(&led_spi))
+	{
+		LOG_ERR("LED SPI bus not ready");
+		return -ENODEV;
+	}
+#endif
 	set_light_color(BLACK);
 	return 0;
 }
 
+/*================= EVENT HANDLERS =================*/
+
 /**
- * @brief Main thread of module. Receives messages and blinks.
+ * @brief Mapping for blinking Bluetooth peer events
  * 
+ * @param event bluetooth peer event
+ * @return enum led_pattern_id pattern to play on the active layer
  */
-static void module_thread_fn(void)
+static enum led_pattern_id pattern_from_peer_event(const struct ble_peer_event *event)
 {
+	switch (event->state)
+	{
+		case PEER_STATE_DISCONNECTED:
+			return PATTERN_DISCONNECTED;
+		case PEER_STATE_CONNECTED:
+			return PATTERN_CONNECTED;
+		case PEER_STATE_SECURED:
+			return PATTERN_SECURED;
+		case PEER_STATE_CONN_FAILED:
+			return PATTERN_CONN_FAILED;
+		default:
+			return PATTERN_NONE;
+	}
+}
 
-	int err;
-	struct led_msg_data msg;
+/**
+ * @brief Main event handler for module
+ * 
+ * @param aeh one of the subscribed events
+ * @return true the event is consumed
+ * @return false the event is not consumed (default)
+ */
+static bool app_event_handler(const struct app_event_header *aeh)
+{
+	if (is_ble_peer_event(aeh))
+	{
+		enum led_pattern_id pattern = pattern_from_peer_event(cast_ble_peer_event(aeh));
 
-	self.thread_id = k_current_get();
+		if (pattern != PATTERN_NONE)
+		{
+			led_play(ACTIVE, pattern);
+		}
+		return false;
+	}
 
-    LOG_DBG("Initializing LED module");
-	err = setup();
-	if (err) {
-		LOG_ERR("setup, error: %d", err);
+	if (is_ble_peer_search_event(aeh))
+	{
+		led_play(BACKGROUND, cast_ble_peer_search_event(aeh)->active ?
+			 PATTERN_SEARCHING : PATTERN_NONE);
+		return false;
 	}
-	LOG_DBG("LED Module initialized");
-	led_blink(1, LONG_BLINK, GREEN);
-	int current_blink_type = BACKGROUND;
-	int remaining_blinks = 0;
-	while (true) {
-		if (current_blink_type == BACKGROUND)
-		{
-			err = module_get_next_msg_no_wait(&self, &msg);
-			if (!err)
+
+	if (is_module_state_event(aeh)) {
+		const struct module_state_event *event = cast_module_state_event(aeh);
+
+		if (check_state(event, MODULE_ID(main), MODULE_STATE_READY)) {
+			if (setup())
 			{
-			current_blink_type = msg.blink_type;
-			remaining_blinks = msg.num_blinks;
+				LOG_ERR("LED module init failed");
+				module_set_state(MODULE_STATE_ERROR);
+				return false;
 			}
+			LOG_DBG("LED Module initialized");
+			led_play(ACTIVE, PATTERN_BOOT);
+			module_set_state(MODULE_STATE_READY);
 		}
-		if (remaining_blinks == 0)
-		{
-			module_get_next_msg(&self, &msg);
-			current_blink_type = msg.blink_type;
-			remaining_blinks = msg.num_blinks;
-		}
-		led_blink_once(msg.blink_duration_msec, msg.blink_color);
-		remaining_blinks--;
+		return false;
 	}
-}
 
-K_THREAD_DEFINE(led_module_thread, CONFIG_LED_MODULE_THREAD_STACK_SIZE,
-		module_thread_fn, NULL, NULL, NULL,
-		K_HIGHEST_APPLICATION_THREAD_PRIO, 0, 0);
+	/* Event not handled but subscribed. */
+	__ASSERT_NO_MSG(false);
+	return false;
+}
 
 APP_EVENT_LISTENER(MODULE, app_event_handler);
 APP_EVENT_SUBSCRIBE(MODULE, module_state_event);
 APP_EVENT_SUBSCRIBE(MODULE, ble_peer_event);
-APP_EVENT_SUBSCRIBE(MODULE, ble_peer_search_event);
\ No newline at end of file
+APP_EVENT_SUBSCRIBE(MODULE, ble_peer_search_event);
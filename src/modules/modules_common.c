@@ -26,6 +26,34 @@ static struct modules_info {
 	atomic_t active_modules_count;
 } modules_info;
 
+/* Logs a message that starts with an application event header. Compiled out
+ * unless CONFIG_MODULES_COMMON_LOG_MESSAGES is enabled.
+ */
+static void log_msg(struct module_data *module, const void *msg, const char *action)
+{
+	if (!IS_ENABLED(CONFIG_MODULES_COMMON_LOG_MESSAGES)) {
+		return;
+	}
+
+	const struct event_prototype *evt_proto = msg;
+	const struct event_type *event = evt_proto->header.type_id;
+
+	if (event->log_event_func) {
+		event->log_event_func(&evt_proto->header);
+	}
+#ifdef CONFIG_APP_EVENT_MANAGER_USE_DEPRECATED_LOG_FUN
+	else if (event->log_event_func_dep) {
+		char buf[50];
+
+		event->log_event_func_dep(&evt_proto->header, buf, sizeof(buf));
+		LOG_DBG("%s module: %s %s",
+			module->name,
+			action,
+			log_strdup(buf));
+	}
+#endif
+}
+
 /* Public interface */
 void module_purge_queue(struct module_data *module)
 {
@@ -36,25 +64,8 @@ int module_get_next_msg(struct module_data *module, void *msg)
 {
 	int err = k_msgq_get(module->msg_q, msg, K_FOREVER);
 
-	if (err == 0 && IS_ENABLED(CONFIG_MODULES_COMMON_LOG_LEVEL_DBG)) {
-		struct event_prototype *evt_proto =
-			(struct event_prototype *)msg;
-		struct event_type *event =
-			(struct event_type *)evt_proto->header.type_id;
-
-		if (event->log_event_func) {
-			event->log_event_func(&evt_proto->header);
-		}
-#ifdef CONFIG_APP_EVENT_MANAGER_USE_DEPRECATED_LOG_FUN
-		else if (event->log_event_func_dep) {
-			char buf[50];
-
-			event->log_event_func_dep(&evt_proto->header, buf, sizeof(buf));
-			LOG_DBG("%s module: Dequeued %s",
-				module->name,
-				log_strdup(buf));
-		}
-#endif
+	if (err == 0) {
+		log_msg(module, msg, "Dequeued");
 	}
 	return err;
 }
@@ -63,72 +74,39 @@ int module_get_next_msg(struct module_data *module, void *msg)
 int module_get_next_msg_no_wait(struct module_data *module, void *msg)
 {
 	int err = k_msgq_get(module->msg_q, msg, K_NO_WAIT);
-	if (err)
-	{
-		return err;
-	}
-
-	if (err == 0 && IS_ENABLED(CONFIG_MODULES_COMMON_LOG_LEVEL_DBG)) {
-		struct event_prototype *evt_proto =
-			(struct event_prototype *)msg;
-		struct event_type *event =
-			(struct event_type *)evt_proto->header.type_id;
 
-		if (event->log_event_func) {
-			event->log_event_func(&evt_proto->header);
-		}
-	#ifdef CONFIG_APP_EVENT_MANAGER_USE_DEPRECATED_LOG_FUN
-			else if (event->log_event_func_dep) {
-				char buf[50];
-
-				event->log_event_func_dep(&evt_proto->header, buf, sizeof(buf));
-				LOG_DBG("%s module: Dequeued %s",
-					module->name,
-					log_strdup(buf));
-			}
-	#endif
-		}
+	if (err == 0) {
+		log_msg(module, msg, "Dequeued");
+	}
 	return err;
 }
 
 int module_enqueue_msg_with_delay(struct module_data *module, void *msg, k_timeout_t delay_msec)
 {
+	uint8_t oldest[CONFIG_MODULES_COMMON_MSG_MAX_SIZE];
 	int err;
 
+	__ASSERT_NO_MSG(module->msg_q->msg_size <= sizeof(oldest));
+
 	err = k_msgq_put(module->msg_q, msg, delay_msec);
+	if (err == -ENOMSG || err == -EAGAIN) {
+		/* Make room by dropping the oldest message. A burst of
+		 * messages then only costs the oldest ones, instead of every
+		 * message that was pending.
+		 */
+		if (k_msgq_get(module->msg_q, oldest, K_NO_WAIT) == 0) {
+			atomic_inc(&module->dropped);
+			log_msg(module, oldest, "Dropped");
+		}
+		err = k_msgq_put(module->msg_q, msg, K_NO_WAIT);
+	}
 	if (err) {
 		LOG_WRN("%s: Message could not be enqueued, error code: %d",
 			module->name, err);
-			/* Purge message queue before reporting an error. This
-			 * makes sure that the calling module can
-			 * enqueue and process new events and is not being
-			 * blocked by a full message queue.
-			 *
-			 * This error is concidered irrecoverable and should be
-			 * rebooted on.
-			 */
-			module_purge_queue(module);
 		return err;
 	}
 
-	if (IS_ENABLED(CONFIG_MODULES_COMMON_LOG_LEVEL_DBG)) {
-		struct event_prototype *evt_proto = (struct event_prototype *)msg;
-		struct event_type *event = (struct event_type *)evt_proto->header.type_id;
-
-		if (event->log_event_func) {
-			event->log_event_func(&evt_proto->header);
-		}
-#ifdef CONFIG_APP_EVENT_MANAGER_USE_DEPRECATED_LOG_FUN
-		else if (event->log_event_func_dep) {
-			char buf[50];
-
-			event->log_event_func_dep(&evt_proto->header, buf, sizeof(buf));
-			LOG_DBG("%s module: Dequeued %s",
-				module->name,
-				log_strdup(buf));
-		}
-#endif
-	}
+	log_msg(module, msg, "Enqueued");
 
 	return 0;
 }
@@ -136,4 +114,4 @@ int module_enqueue_msg_with_delay(struct module_data *module, void *msg, k_timeo
 int module_enqueue_msg(struct module_data *module, void *msg)
 {
 	return module_enqueue_msg_with_delay(module, msg, K_NO_WAIT);
-}
\ No newline at end of file
+}
@@ -37,6 +37,8 @@ struct module_data {
 	struct k_msgq *msg_q;
 	/* Flag signifying if the module supports shutdown. */
 	bool supports_shutdown;
+	/* Number of messages dropped to make room in a full queue. */
+	atomic_t dropped;
 };
 
 /** @brief Purge a module's queue.
@@ -67,6 +69,8 @@ int module_get_next_msg(struct module_data *module, void *msg);
 int module_get_next_msg_no_wait(struct module_data *module, void *msg);
 
 /** @brief Enqueue message to a module's queue.
+ *
+ *  If the queue is full, the oldest message is dropped to make room.
  *
  *  @param[in] module Pointer to a structure containing module metadata.
  *  @param[in] msg Pointer to a message that will be enqueued.
@@ -76,6 +80,9 @@ int module_get_next_msg_no_wait(struct module_data *module, void *msg);
 int module_enqueue_msg(struct module_data *module, void *msg);
 
 /** @brief Enqueue message to a module's queue.
+ *
+ *  If the queue is still full after the delay, the oldest message is
+ *  dropped to make room.
  *
  *  @param[in] module Pointer to a structure containing module metadata.
  *  @param[in] msg Pointer to a message that will be enqueued.
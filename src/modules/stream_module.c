@@ -0,0 +1,545 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/types.h>
+
+#include <zephyr/sys/util.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/ring_buffer.h>
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+
+#include <drivers/sensor.h>
+
+#include <caf/events/ble_common_event.h>
+#include "qdec_gpio.h"
+
+#define MODULE stream_module
+#include <caf/events/module_state_event.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(MODULE, CONFIG_STREAM_MODULE_LOG_LEVEL);
+
+/**
+ * Raw encoder streaming service.
+ *
+ * The encoder tick counters are sampled every
+ * CONFIG_STREAM_MODULE_SAMPLE_PERIOD_MS from a timer and the samples are
+ * queued in a ring buffer. A low priority work queue drains the buffer into
+ * notifications that are filled up to the ATT MTU, so that a research client
+ * gets the full resolution data without the HID report path being delayed.
+ * Data is only sampled while a client is subscribed.
+ */
+
+/* Stream service 6e570000-7d3a-4b8e-9f1c-3b5d0c7a2e10 */
+#define BT_UUID_STREAM_SERVICE_VAL \
+    BT_UUID_128_ENCODE(0x6e570000, 0x7d3a, 0x4b8e, 0x9f1c, 0x3b5d0c7a2e10)
+/* Sample notifications */
+#define BT_UUID_STREAM_DATA_VAL \
+    BT_UUID_128_ENCODE(0x6e570001, 0x7d3a, 0x4b8e, 0x9f1c, 0x3b5d0c7a2e10)
+/* Stream statistics, read-only */
+#define BT_UUID_STREAM_STATS_VAL \
+    BT_UUID_128_ENCODE(0x6e570002, 0x7d3a, 0x4b8e, 0x9f1c, 0x3b5d0c7a2e10)
+
+#define BT_UUID_STREAM_SERVICE BT_UUID_DECLARE_128(BT_UUID_STREAM_SERVICE_VAL)
+#define BT_UUID_STREAM_DATA    BT_UUID_DECLARE_128(BT_UUID_STREAM_DATA_VAL)
+#define BT_UUID_STREAM_STATS   BT_UUID_DECLARE_128(BT_UUID_STREAM_STATS_VAL)
+
+/**
+ * @brief Header of every notification, all fields in little endian.
+ *        It is followed by as many samples as fit into the ATT MTU.
+ */
+struct stream_header {
+    /* Incremented with every notification */
+    uint16_t sequence;
+    /* Samples dropped since the previous notification, saturating */
+    uint16_t dropped;
+} __packed;
+
+/**
+ * @brief One sample of the tick counters, all fields in little endian.
+ */
+struct stream_sample {
+    /* Uptime at capture, modulo 65536 [ms] */
+    uint16_t timestamp_ms;
+    /* Ticks counted since the previous sample, saturating */
+    int16_t ticks_a;
+    int16_t ticks_b;
+} __packed;
+
+/**
+ * @brief Layout of the statistics characteristic, all fields in little
+ *        endian. The counters run from boot.
+ */
+struct stream_stats {
+    /* Samples queued for sending */
+    uint32_t captured;
+    /* Samples lost because the buffer was full */
+    uint32_t dropped;
+    /* Samples with a tick count that did not fit into 16 bits */
+    uint32_t saturated;
+    /* Notifications queued in the Bluetooth stack */
+    uint32_t notifications;
+    /* Notifications the Bluetooth stack could not queue */
+    uint32_t notify_failed;
+} __packed;
+
+/* Largest notification payload with the maximum LL data length. */
+#define STREAM_PAYLOAD_MAX_SIZE 244
+#define STREAM_SAMPLE_SIZE sizeof(struct stream_sample)
+#define STREAM_BUFFER_SIZE (CONFIG_STREAM_MODULE_BUFFER_SAMPLES * STREAM_SAMPLE_SIZE)
+/* Flush the buffer at least this often while streaming [samples]. */
+#define STREAM_FLUSH_SAMPLES \
+    MAX(1, CONFIG_STREAM_MODULE_FLUSH_MS / CONFIG_STREAM_MODULE_SAMPLE_PERIOD_MS)
+
+/* Index of the sample characteristic value in the service attributes. */
+#define STREAM_DATA_ATTR_INDEX 2
+
+RING_BUF_DECLARE(sample_ring, STREAM_BUFFER_SIZE);
+
+static const struct device *encoder_a_dev;
+static const struct device *encoder_b_dev;
+
+/* Only accessed from the sampling timer. */
+static int32_t prev_total_a;
+static int32_t prev_total_b;
+static uint32_t samples_since_flush;
+
+/* Statistics, updated from the sampling timer and the work queue. */
+static atomic_t captured;
+static atomic_t dropped;
+static atomic_t dropped_pending;
+static atomic_t saturated;
+static atomic_t notifications;
+static atomic_t notify_failed;
+
+/* Notifications queued in the stack and not yet sent. */
+static atomic_t in_flight;
+/* Incremented when a stream starts, completions of an older stream are
+ * ignored so that they cannot take the count below zero.
+ */
+static atomic_t stream_generation;
+/* Set while at least one client has notifications enabled. */
+static atomic_t subscribed;
+
+/* Only accessed from the stream work queue. */
+static struct bt_conn *stream_conn;
+static bool streaming;
+static uint16_t sequence;
+static uint8_t tx_buf[STREAM_PAYLOAD_MAX_SIZE];
+
+/* Connected peers, updated from the event handler. */
+static struct bt_conn *peers[CONFIG_BT_MAX_CONN];
+static struct k_spinlock peers_lock;
+
+static K_THREAD_STACK_DEFINE(stream_stack, CONFIG_STREAM_MODULE_THREAD_STACK_SIZE);
+static struct k_work_q stream_work_q;
+
+static void drain_work_handler(struct k_work *work);
+static K_WORK_DEFINE(drain_work, drain_work_handler);
+static void control_work_handler(struct k_work *work);
+static K_WORK_DEFINE(control_work, control_work_handler);
+
+static void ccc_changed(const struct bt_gatt_attr *attr, uint16_t value);
+static ssize_t read_stats(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                          void *buf, uint16_t len, uint16_t offset);
+
+BT_GATT_SERVICE_DEFINE(stream_svc,
+    BT_GATT_PRIMARY_SERVICE(BT_UUID_STREAM_SERVICE),
+    BT_GATT_CHARACTERISTIC(BT_UUID_STREAM_DATA, BT_GATT_CHRC_NOTIFY,
+                           BT_GATT_PERM_NONE, NULL, NULL, NULL),
+    BT_GATT_CCC(ccc_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE_ENCRYPT),
+    BT_GATT_CHARACTERISTIC(BT_UUID_STREAM_STATS, BT_GATT_CHRC_READ,
+                           BT_GATT_PERM_READ_ENCRYPT, read_stats, NULL, NULL),
+);
+
+/**========================================================================
+ *                              Sampling
+ *========================================================================**/
+
+static int32_t read_total_ticks(const struct device *dev)
+{
+    struct sensor_value val;
+
+    if (sensor_channel_get(dev, (enum sensor_channel)QDEC_GPIO_CHAN_TOTAL_TICKS, &val))
+    {
+        return 0;
+    }
+    return val.val1;
+}
+
+static int16_t saturate_ticks(int32_t ticks, bool *clipped)
+{
+    if (ticks > INT16_MAX || ticks < INT16_MIN)
+    {
+        *clipped = true;
+        return ticks > 0 ? INT16_MAX : INT16_MIN;
+    }
+    return (int16_t)ticks;
+}
+
+/**
+ * @brief Samples the tick counters, runs in the system clock interrupt.
+ */
+static void sample_timer_handler(struct k_timer *timer)
+{
+    int32_t total_a = read_total_ticks(encoder_a_dev);
+    int32_t total_b = read_total_ticks(encoder_b_dev);
+    int32_t delta_a = total_a - prev_total_a;
+    int32_t delta_b = total_b - prev_total_b;
+    bool clipped = false;
+    uint8_t sample[STREAM_SAMPLE_SIZE];
+
+    prev_total_a = total_a;
+    prev_total_b = total_b;
+
+    if (!(IS_ENABLED(CONFIG_STREAM_MODULE_SKIP_IDLE) && !delta_a && !delta_b))
+    {
+        sys_put_le16((uint16_t)k_uptime_get_32(), &sample[0]);
+        sys_put_le16((uint16_t)saturate_ticks(delta_a, &clipped), &sample[2]);
+        sys_put_le16((uint16_t)saturate_ticks(delta_b, &clipped), &sample[4]);
+        if (clipped)
+        {
+            atomic_inc(&saturated);
+        }
+
+        if (ring_buf_put(&sample_ring, sample, sizeof(sample)) == sizeof(sample))
+        {
+            atomic_inc(&captured);
+        }
+        else
+        {
+            atomic_inc(&dropped);
+            atomic_inc(&dropped_pending);
+        }
+    }
+
+    if ((ring_buf_size_get(&sample_ring) >= STREAM_PAYLOAD_MAX_SIZE) ||
+        (++samples_since_flush >= STREAM_FLUSH_SAMPLES))
+    {
+        samples_since_flush = 0;
+        k_work_submit_to_queue(&stream_work_q, &drain_work);
+    }
+}
+
+static K_TIMER_DEFINE(sample_timer, sample_timer_handler, NULL);
+
+/**========================================================================
+ *                            Notifications
+ *========================================================================**/
+
+static void notify_sent_cb(struct bt_conn *conn, void *user_data)
+{
+    if ((atomic_val_t)POINTER_TO_INT(user_data) != atomic_get(&stream_generation))
+    {
+        /* Sent on a connection that is no longer streamed to. */
+        return;
+    }
+    atomic_dec(&in_flight);
+    k_work_submit_to_queue(&stream_work_q, &drain_work);
+}
+
+/**
+ * @brief Asks for the largest LL data length and the 2M PHY, so that a
+ *        full notification is sent in a single short packet.
+ *
+ * @param conn Connection of the streaming client
+ */
+static void request_fast_link(struct bt_conn *conn)
+{
+    int err;
+
+    err = bt_conn_le_data_len_update(conn, BT_LE_DATA_LEN_PARAM_MAX);
+    if (err)
+    {
+        LOG_WRN("Data length update failed (%d)", err);
+    }
+
+    err = bt_conn_le_phy_update(conn, BT_CONN_LE_PHY_PARAM_2M);
+    if (err)
+    {
+        LOG_WRN("PHY update failed (%d)", err);
+    }
+}
+
+/**
+ * @brief Finds the connection to stream to, the first peer that enabled
+ *        notifications.
+ *
+ * @return Referenced connection, or NULL if no peer is subscribed
+ */
+static struct bt_conn *find_subscriber(void)
+{
+    struct bt_conn *conns[CONFIG_BT_MAX_CONN];
+    struct bt_conn *found = NULL;
+    k_spinlock_key_t key = k_spin_lock(&peers_lock);
+
+    for (size_t i = 0; i < ARRAY_SIZE(peers); i++)
+    {
+        conns[i] = peers[i] ? bt_conn_ref(peers[i]) : NULL;
+    }
+    k_spin_unlock(&peers_lock, key);
+
+    for (size_t i = 0; i < ARRAY_SIZE(conns); i++)
+    {
+        if (!conns[i])
+        {
+            continue;
+        }
+        if (!found && bt_gatt_is_subscribed(conns[i], &stream_svc.attrs[STREAM_DATA_ATTR_INDEX],
+                                            BT_GATT_CCC_NOTIFY))
+        {
+            found = conns[i];
+            continue;
+        }
+        bt_conn_unref(conns[i]);
+    }
+    return found;
+}
+
+/**
+ * @brief Sends one notification holding as many queued samples as fit
+ *
+ * @return true if a notification was queued and more may follow
+ */
+static bool send_batch(void)
+{
+    uint16_t payload_size = MIN(bt_gatt_get_mtu(stream_conn) - 3, sizeof(tx_buf));
+    uint32_t max_samples = (payload_size - sizeof(struct stream_header)) / STREAM_SAMPLE_SIZE;
+    uint32_t len = ring_buf_peek(&sample_ring, &tx_buf[sizeof(struct stream_header)],
+                                 max_samples * STREAM_SAMPLE_SIZE);
+    struct bt_gatt_notify_params params = {
+        .attr = &stream_svc.attrs[STREAM_DATA_ATTR_INDEX],
+        .data = tx_buf,
+        .func = notify_sent_cb,
+        .user_data = INT_TO_POINTER(atomic_get(&stream_generation)),
+    };
+    int err;
+
+    len -= len % STREAM_SAMPLE_SIZE;
+    if (!len)
+    {
+        return false;
+    }
+
+    sys_put_le16(sequence, &tx_buf[0]);
+    sys_put_le16(MIN(atomic_get(&dropped_pending), UINT16_MAX), &tx_buf[2]);
+    params.len = sizeof(struct stream_header) + len;
+
+    atomic_inc(&in_flight);
+    err = bt_gatt_notify_cb(stream_conn, &params);
+    if (err)
+    {
+        /* Keep the samples, the next completion or flush retries. */
+        atomic_dec(&in_flight);
+        atomic_inc(&notify_failed);
+        LOG_DBG("Cannot send stream notification (%d)", err);
+        return false;
+    }
+
+    ring_buf_get(&sample_ring, NULL, len);
+    atomic_clear(&dropped_pending);
+    atomic_inc(&notifications);
+    sequence++;
+    return true;
+}
+
+static void drain_work_handler(struct k_work *work)
+{
+    if (!streaming || !stream_conn)
+    {
+        return;
+    }
+
+    while (atomic_get(&in_flight) < CONFIG_STREAM_MODULE_MAX_IN_FLIGHT)
+    {
+        if (!send_batch())
+        {
+            break;
+        }
+    }
+}
+
+static void stop_streaming(void)
+{
+    k_timer_stop(&sample_timer);
+    streaming = false;
+    if (stream_conn)
+    {
+        bt_conn_unref(stream_conn);
+        stream_conn = NULL;
+    }
+    LOG_INF("Streaming stopped: %u captured, %u dropped, %u notifications, %u failed",
+            (uint32_t)atomic_get(&captured), (uint32_t)atomic_get(&dropped),
+            (uint32_t)atomic_get(&notifications), (uint32_t)atomic_get(&notify_failed));
+}
+
+/**
+ * @brief Starts or stops sampling when the subscription or the set of
+ *        connected peers changes.
+ */
+static void control_work_handler(struct k_work *work)
+{
+    struct bt_conn *conn = atomic_get(&subscribed) ? find_subscriber() : NULL;
+
+    if (conn == stream_conn)
+    {
+        if (conn)
+        {
+            bt_conn_unref(conn);
+        }
+        return;
+    }
+
+    if (streaming)
+    {
+        stop_streaming();
+    }
+    if (!conn)
+    {
+        return;
+    }
+
+    stream_conn = conn;
+    request_fast_link(stream_conn);
+
+    /* Notifications of a dropped connection may never complete. */
+    atomic_inc(&stream_generation);
+    atomic_clear(&in_flight);
+    ring_buf_reset(&sample_ring);
+    atomic_clear(&dropped_pending);
+    sequence = 0;
+    prev_total_a = read_total_ticks(encoder_a_dev);
+    prev_total_b = read_total_ticks(encoder_b_dev);
+    samples_since_flush = 0;
+    streaming = true;
+    k_timer_start(&sample_timer, K_MSEC(CONFIG_STREAM_MODULE_SAMPLE_PERIOD_MS),
+                  K_MSEC(CONFIG_STREAM_MODULE_SAMPLE_PERIOD_MS));
+    LOG_INF("Streaming started");
+}
+
+static void ccc_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    atomic_set(&subscribed, value == BT_GATT_CCC_NOTIFY);
+    k_work_submit_to_queue(&stream_work_q, &control_work);
+}
+
+static ssize_t read_stats(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                          void *buf, uint16_t len, uint16_t offset)
+{
+    uint8_t stats[sizeof(struct stream_stats)];
+
+    sys_put_le32(atomic_get(&captured), &stats[0]);
+    sys_put_le32(atomic_get(&dropped), &stats[4]);
+    sys_put_le32(atomic_get(&saturated), &stats[8]);
+    sys_put_le32(atomic_get(&notifications), &stats[12]);
+    sys_put_le32(atomic_get(&notify_failed), &stats[16]);
+
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, stats, sizeof(stats));
+}
+
+/**========================================================================
+ *                           Event handlers
+ *========================================================================**/
+
+static void update_peers(const struct ble_peer_event *event)
+{
+    k_spinlock_key_t key;
+
+    switch (event->state)
+    {
+    case PEER_STATE_CONNECTED:
+        key = k_spin_lock(&peers_lock);
+        for (size_t i = 0; i < ARRAY_SIZE(peers); i++)
+        {
+            if (!peers[i])
+            {
+                peers[i] = bt_conn_ref(event->id);
+                break;
+            }
+        }
+        k_spin_unlock(&peers_lock, key);
+        break;
+
+    case PEER_STATE_DISCONNECTED:
+        key = k_spin_lock(&peers_lock);
+        for (size_t i = 0; i < ARRAY_SIZE(peers); i++)
+        {
+            if (peers[i] == event->id)
+            {
+                bt_conn_unref(peers[i]);
+                peers[i] = NULL;
+            }
+        }
+        k_spin_unlock(&peers_lock, key);
+        k_work_submit_to_queue(&stream_work_q, &control_work);
+        break;
+
+    default:
+        /* No action */
+        break;
+    }
+}
+
+static int module_init(void)
+{
+    encoder_a_dev = device_get_binding(DT_LABEL(DT_NODELABEL(qdeca)));
+    encoder_b_dev = device_get_binding(DT_LABEL(DT_NODELABEL(qdecb)));
+    if (encoder_a_dev == NULL || encoder_b_dev == NULL)
+    {
+        LOG_ERR("Failed to get bindings for encoder devices");
+        return -ENODEV;
+    }
+
+    k_work_queue_start(&stream_work_q, stream_stack,
+                       K_THREAD_STACK_SIZEOF(stream_stack),
+                       CONFIG_STREAM_MODULE_THREAD_PRIORITY, NULL);
+    k_thread_name_set(&stream_work_q.thread, "stream");
+
+    return 0;
+}
+
+static bool app_event_handler(const struct app_event_header *aeh)
+{
+    if (is_ble_peer_event(aeh))
+    {
+        update_peers(cast_ble_peer_event(aeh));
+
+        return false;
+    }
+
+    if (is_module_state_event(aeh))
+    {
+        const struct module_state_event *event = cast_module_state_event(aeh);
+
+        if (check_state(event, MODULE_ID(main), MODULE_STATE_READY))
+        {
+            if (module_init())
+            {
+                LOG_ERR("Stream module init failed");
+                module_set_state(MODULE_STATE_ERROR);
+
+                return false;
+            }
+            LOG_INF("Stream module initialized");
+            module_set_state(MODULE_STATE_READY);
+        }
+
+        return false;
+    }
+
+    /* If event is unhandled, unsubscribe. */
+    __ASSERT_NO_MSG(false);
+    return false;
+}
+
+APP_EVENT_LISTENER(MODULE, app_event_handler);
+APP_EVENT_SUBSCRIBE(MODULE, module_state_event);
+APP_EVENT_SUBSCRIBE(MODULE, ble_peer_event);
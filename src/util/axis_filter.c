@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <float.h>
+#include <math.h>
+#include "axis_filter.h"
+
+#define PI_F 3.14159265358979323846f
+/* Q of a 2nd order Butterworth low-pass */
+#define BUTTERWORTH_Q 0.70710678118654752440f
+
+bool axis_filter_config_valid(const struct axis_filter_config *config)
+{
+	return config->deadzone_permille < 1000 && config->knee_permille <= 1000;
+}
+
+static void lowpass_compute(uint16_t cutoff_dhz, float sample_period_s,
+			    struct axis_filter_coeffs *coeffs)
+{
+	float cutoff_hz = (float)cutoff_dhz / 10.0f;
+	float w0, cos_w0, alpha, a0;
+
+	if (cutoff_dhz == 0 || cutoff_hz * sample_period_s >= 0.5f) {
+		coeffs->b0 = 1.0f;
+		coeffs->b1 = 0.0f;
+		coeffs->b2 = 0.0f;
+		coeffs->a1 = 0.0f;
+		coeffs->a2 = 0.0f;
+		return;
+	}
+
+	/* Bilinear transform of the analog prototype, as in the RBJ cookbook. */
+	w0 = 2.0f * PI_F * cutoff_hz * sample_period_s;
+	cos_w0 = cosf(w0);
+	alpha = sinf(w0) / (2.0f * BUTTERWORTH_Q);
+	a0 = 1.0f + alpha;
+
+	coeffs->b0 = (1.0f - cos_w0) / (2.0f * a0);
+	coeffs->b1 = (1.0f - cos_w0) / a0;
+	coeffs->b2 = coeffs->b0;
+	coeffs->a1 = -2.0f * cos_w0 / a0;
+	coeffs->a2 = (1.0f - alpha) / a0;
+}
+
+void axis_filter_coeffs_compute(const struct axis_filter_config *config, float sample_period_s,
+				struct axis_filter_coeffs *coeffs)
+{
+	lowpass_compute(config->lowpass_cutoff_dhz, sample_period_s, coeffs);
+
+	coeffs->max_step = (config->slew_rate_permille == 0) ? FLT_MAX :
+			   (float)config->slew_rate_permille / 1000.0f * sample_period_s;
+
+	coeffs->deadzone = (float)config->deadzone_permille / 1000.0f;
+	coeffs->deadzone_gain = 1.0f / (1.0f - coeffs->deadzone);
+
+	/* Without a knee, x*x*knee_inv >= x for every x the chain can output. */
+	coeffs->knee_inv = (config->knee_permille == 0) ? 1.0e9f :
+			   1000.0f / (float)config->knee_permille;
+}
+
+void axis_filter_reset(struct axis_filter_state *state)
+{
+	state->z1 = 0.0f;
+	state->z2 = 0.0f;
+	state->prev = 0.0f;
+}
+
+float axis_filter_run(const struct axis_filter_coeffs *coeffs, struct axis_filter_state *state,
+		      float x)
+{
+	float y, mag;
+
+	/* Low-pass */
+	y = coeffs->b0 * x + state->z1;
+	state->z1 = coeffs->b1 * x - coeffs->a1 * y + state->z2;
+	state->z2 = coeffs->b2 * x - coeffs->a2 * y;
+
+	/* Slew rate limiter */
+	y = CLAMP(y, state->prev - coeffs->max_step, state->prev + coeffs->max_step);
+	state->prev = y;
+
+	/* Deadzone, rescaled to keep full scale */
+	mag = MAX(fabsf(y) - coeffs->deadzone, 0.0f) * coeffs->deadzone_gain;
+
+	/* Slow start, x^2/knee below the knee and linear above */
+	mag = MIN(mag, mag * mag * coeffs->knee_inv);
+
+	return copysignf(mag, y);
+}
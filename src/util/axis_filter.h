@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _AXIS_FILTER_H_
+#define _AXIS_FILTER_H_
+
+/**@file
+ *@brief Axis output filter library header.
+ */
+
+#include <zephyr/types.h>
+
+/**
+ * @defgroup axis_filter Axis output filter library
+ * @{
+ * @brief Filter chain for a normalized joystick axis signal.
+ *
+ * The chain is a 2nd order low-pass biquad, a slew rate limiter, a
+ * deadzone and a slow start curve, always run in that order. Disabled
+ * stages get pass-through coefficients instead of being skipped, so
+ * @ref axis_filter_run has no branches on the configuration and does
+ * not allocate.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Configuration of the filter chain of one axis, all fields in little endian. */
+struct axis_filter_config {
+	/* Cutoff frequency of the low-pass, 0 to disable [0.1 Hz] */
+	uint16_t lowpass_cutoff_dhz;
+	/* Largest change of the output, 0 to disable [permille of full scale per second] */
+	uint16_t slew_rate_permille;
+	/* Inputs below this magnitude give zero output [permille of full scale] */
+	uint16_t deadzone_permille;
+	/* Inputs below this magnitude are mapped quadratically, 0 to disable [permille of full scale] */
+	uint16_t knee_permille;
+} __packed;
+
+/** @brief Coefficients of the filter chain, computed by @ref axis_filter_coeffs_compute. */
+struct axis_filter_coeffs {
+	/* Biquad numerator and denominator, a0 normalized to 1 */
+	float b0;
+	float b1;
+	float b2;
+	float a1;
+	float a2;
+	/* Largest change of the output per sample */
+	float max_step;
+	float deadzone;
+	/* Rescales the output of the deadzone to full scale */
+	float deadzone_gain;
+	/* Inverse of the slow start knee */
+	float knee_inv;
+};
+
+/** @brief State of the filter chain of one axis. */
+struct axis_filter_state {
+	/* Biquad delay line, transposed direct form II */
+	float z1;
+	float z2;
+	/* Previous output of the slew rate limiter */
+	float prev;
+};
+
+/** @brief Check that a filter configuration is valid.
+ *
+ *  @param[in] config Filter configuration.
+ *
+ *  @return true if valid.
+ */
+bool axis_filter_config_valid(const struct axis_filter_config *config);
+
+/** @brief Compute the coefficients of a filter chain.
+ *
+ *  A low-pass cutoff at or above the Nyquist frequency disables the low-pass.
+ *
+ *  @param[in] config Filter configuration.
+ *  @param[in] sample_period_s Time between samples in seconds.
+ *  @param[out] coeffs Coefficients.
+ */
+void axis_filter_coeffs_compute(const struct axis_filter_config *config, float sample_period_s,
+				struct axis_filter_coeffs *coeffs);
+
+/** @brief Reset the state of a filter chain to a resting input.
+ *
+ *  @param[out] state Filter state.
+ */
+void axis_filter_reset(struct axis_filter_state *state);
+
+/** @brief Run one sample through a filter chain.
+ *
+ *  @param[in] coeffs Coefficients.
+ *  @param[in,out] state Filter state.
+ *  @param[in] x Input sample, normalized to [-1, 1].
+ *
+ *  @return Output sample.
+ */
+float axis_filter_run(const struct axis_filter_coeffs *coeffs, struct axis_filter_state *state,
+		      float x);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* _AXIS_FILTER_H_ */
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <app_event_manager.h>
+#include <caf/events/ble_common_event.h>
+#include "boot_trace.h"
+
+#define MODULE boot_trace
+#include <caf/events/module_state_event.h>
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(MODULE, CONFIG_BOOT_TRACE_LOG_LEVEL);
+
+enum mark_kind {
+	MARK_PHASE,
+	MARK_MODULE_READY,
+	MARK_MODULE_ERROR,
+};
+
+struct boot_mark {
+	const char *name;
+	uint32_t time_us;
+	enum mark_kind kind;
+};
+
+static struct boot_mark marks[CONFIG_BOOT_TRACE_MAX_MARKS];
+static size_t mark_count;
+static size_t marks_lost;
+static bool done;
+static bool adv_seen;
+static bool peer_seen;
+
+/* Marks come from main and from the work queues. */
+static struct k_spinlock lock;
+
+static void timeout_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(timeout_work, timeout_work_handler);
+
+static void add_mark(const char *name, enum mark_kind kind)
+{
+	uint32_t now = k_ticks_to_us_floor32(k_uptime_ticks());
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	if (!done) {
+		if (mark_count < ARRAY_SIZE(marks)) {
+			marks[mark_count].name = name;
+			marks[mark_count].time_us = now;
+			marks[mark_count].kind = kind;
+			mark_count++;
+		} else {
+			marks_lost++;
+		}
+	}
+	k_spin_unlock(&lock, key);
+}
+
+void boot_trace_mark(const char *name)
+{
+	if (done) {
+		return;
+	}
+	add_mark(name, MARK_PHASE);
+}
+
+void boot_trace_done(const char *name)
+{
+	k_spinlock_key_t key;
+	uint32_t prev_us = 0;
+
+	if (done) {
+		return;
+	}
+	add_mark(name, MARK_PHASE);
+
+	key = k_spin_lock(&lock);
+	done = true;
+	k_spin_unlock(&lock, key);
+
+	k_work_cancel_delayable(&timeout_work);
+
+	LOG_INF("Boot phases [ms since reset, ms since previous]:");
+	for (size_t i = 0; i < mark_count; i++) {
+		const struct boot_mark *mark = &marks[i];
+		const char *suffix = (mark->kind == MARK_MODULE_READY) ? " ready" :
+				     (mark->kind == MARK_MODULE_ERROR) ? " error" : "";
+
+		LOG_INF("%6u.%03u +%5u.%03u  %s%s",
+			mark->time_us / 1000, mark->time_us % 1000,
+			(mark->time_us - prev_us) / 1000, (mark->time_us - prev_us) % 1000,
+			mark->name, suffix);
+		prev_us = mark->time_us;
+	}
+	if (marks_lost) {
+		LOG_WRN("%u boot phases not recorded, increase CONFIG_BOOT_TRACE_MAX_MARKS",
+			marks_lost);
+	}
+}
+
+static void timeout_work_handler(struct k_work *work)
+{
+	boot_trace_done("timeout");
+}
+
+static bool app_event_handler(const struct app_event_header *aeh)
+{
+	if (done) {
+		return false;
+	}
+
+	if (is_module_state_event(aeh)) {
+		const struct module_state_event *event = cast_module_state_event(aeh);
+
+		if (event->state == MODULE_STATE_READY) {
+			add_mark(module_name_get(event->module_id), MARK_MODULE_READY);
+		} else if (event->state == MODULE_STATE_ERROR) {
+			add_mark(module_name_get(event->module_id), MARK_MODULE_ERROR);
+		}
+		if (check_state(event, MODULE_ID(main), MODULE_STATE_READY)) {
+			k_work_reschedule(&timeout_work, K_MSEC(CONFIG_BOOT_TRACE_TIMEOUT_MS));
+		}
+		return false;
+	}
+
+	if (is_ble_peer_search_event(aeh)) {
+		if (!adv_seen && cast_ble_peer_search_event(aeh)->active) {
+			adv_seen = true;
+			add_mark("advertising", MARK_PHASE);
+		}
+		return false;
+	}
+
+	if (is_ble_peer_event(aeh)) {
+		const struct ble_peer_event *event = cast_ble_peer_event(aeh);
+
+		if (!peer_seen && (event->state == PEER_STATE_SECURED)) {
+			peer_seen = true;
+			add_mark("peer secured", MARK_PHASE);
+		}
+		return false;
+	}
+
+	/* Event not handled but subscribed. */
+	__ASSERT_NO_MSG(false);
+	return false;
+}
+
+APP_EVENT_LISTENER(MODULE, app_event_handler);
+APP_EVENT_SUBSCRIBE_FIRST(MODULE, module_state_event);
+APP_EVENT_SUBSCRIBE(MODULE, ble_peer_search_event);
+APP_EVENT_SUBSCRIBE(MODULE, ble_peer_event);
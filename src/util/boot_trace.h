@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _BOOT_TRACE_H_
+#define _BOOT_TRACE_H_
+
+/**@file
+ *@brief Boot trace library header.
+ */
+
+#include <zephyr/kernel.h>
+
+/**
+ * @defgroup boot_trace Boot trace library
+ * @{
+ * @brief Timestamps of the boot phases, logged as one summary.
+ *
+ * Module state changes, the start of advertising and the first peer
+ * connection are recorded by the library itself. Other phases are marked
+ * by the modules with @ref boot_trace_mark. The summary is logged by
+ * @ref boot_trace_done, or after CONFIG_BOOT_TRACE_TIMEOUT_MS.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if IS_ENABLED(CONFIG_BOOT_TRACE)
+
+/** @brief Record the current uptime for a boot phase.
+ *
+ *  Does nothing once the summary has been logged, so it is cheap to call
+ *  on a path that runs for every sample.
+ *
+ *  @param name Name of the phase. Must be a string literal.
+ */
+void boot_trace_mark(const char *name);
+
+/** @brief Record a last phase and log the summary.
+ *
+ *  @param name Name of the last phase. Must be a string literal.
+ */
+void boot_trace_done(const char *name);
+
+#else
+
+static inline void boot_trace_mark(const char *name) {}
+static inline void boot_trace_done(const char *name) {}
+
+#endif /* CONFIG_BOOT_TRACE */
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* _BOOT_TRACE_H_ */
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <math.h>
+#include "dead_reckoning.h"
+
+#define PI_F 3.14159265358979323846f
+
+void dead_reckoning_reset(struct dead_reckoning *dr)
+{
+	dr->total_a = 0;
+	dr->total_b = 0;
+	dr->base_distance = 0.0f;
+	dr->base_heading = 0.0f;
+	dr->x = 0.0f;
+	dr->y = 0.0f;
+	dr->heading = 0.0f;
+}
+
+void dead_reckoning_rebase(struct dead_reckoning *dr, const struct dead_reckoning_geometry *geo)
+{
+	if (!dr->total_a && !dr->total_b) {
+		return;
+	}
+	dr->base_distance = dead_reckoning_distance(dr, geo);
+	/* The heading of the last step was computed with this geometry. */
+	dr->base_heading = dr->heading;
+	dr->total_a = 0;
+	dr->total_b = 0;
+}
+
+void dead_reckoning_update(struct dead_reckoning *dr, const struct dead_reckoning_geometry *geo,
+			   int32_t ticks_a, int32_t ticks_b)
+{
+	float step, heading, mid;
+
+	dr->total_a += ticks_a;
+	dr->total_b += ticks_b;
+
+	/* Same model as the HID module: speed r_c*(w_a+w_b), turn rate r_c*(w_b-w_a)/r_p */
+	step = geo->m_per_tick * (float)(ticks_a + ticks_b);
+	heading = dr->base_heading +
+		  geo->m_per_tick * (float)(dr->total_b - dr->total_a) / geo->half_track;
+	mid = 0.5f * (dr->heading + heading);
+
+	dr->x += step * sinf(mid);
+	dr->y += step * cosf(mid);
+	dr->heading = heading;
+}
+
+float dead_reckoning_distance(const struct dead_reckoning *dr,
+			      const struct dead_reckoning_geometry *geo)
+{
+	return dr->base_distance + geo->m_per_tick * (float)(dr->total_a + dr->total_b);
+}
+
+float dead_reckoning_heading(const struct dead_reckoning *dr)
+{
+	float heading = fmodf(dr->heading + PI_F, 2.0f * PI_F);
+
+	if (heading < 0.0f) {
+		heading += 2.0f * PI_F;
+	}
+	return heading - PI_F;
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _DEAD_RECKONING_H_
+#define _DEAD_RECKONING_H_
+
+/**@file
+ *@brief Dead reckoning library header.
+ */
+
+#include <zephyr/types.h>
+
+/**
+ * @defgroup dead_reckoning Dead reckoning library
+ * @{
+ * @brief Position and heading of a differential drive from wheel ticks.
+ *
+ * Distance and heading are computed from the cumulative tick counts of the
+ * two wheels, so they do not drift. Only x and y are integrated, one step
+ * per sample, along the mean heading of the step.
+ *
+ * Heading is 0 straight ahead along the y-axis and positive clockwise,
+ * matching the turn rate of the HID module.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Geometry of the drive. */
+struct dead_reckoning_geometry {
+	/* Travel of a wheel surface per encoder tick [m] */
+	float m_per_tick;
+	/* Half of the distance between the wheels [m] */
+	float half_track;
+};
+
+/** @brief State of the integrator. */
+struct dead_reckoning {
+	/* Cumulative ticks of the right-hand (a) and left-hand (b) wheels,
+	 * since the last change of geometry
+	 */
+	int64_t total_a;
+	int64_t total_b;
+	/* Distance [m] and heading [rad] at the last change of geometry */
+	float base_distance;
+	float base_heading;
+	/* Position [m] */
+	float x;
+	float y;
+	/* Heading after the previous step [rad], unwrapped */
+	float heading;
+};
+
+/** @brief Reset the position, distance and heading to zero.
+ *
+ *  @param[out] dr Integrator.
+ */
+void dead_reckoning_reset(struct dead_reckoning *dr);
+
+/** @brief Keep the distance and heading over a change of geometry.
+ *
+ *  Folds the ticks counted so far into the distance and heading, using the
+ *  geometry they were counted with, so that a new geometry only applies to
+ *  the ticks that follow.
+ *
+ *  @param[in,out] dr Integrator.
+ *  @param[in] geo Geometry of the drive used until now.
+ */
+void dead_reckoning_rebase(struct dead_reckoning *dr, const struct dead_reckoning_geometry *geo);
+
+/** @brief Integrate one sample.
+ *
+ *  @param[in,out] dr Integrator.
+ *  @param[in] geo Geometry of the drive.
+ *  @param[in] ticks_a Ticks of the right-hand wheel during the sample.
+ *  @param[in] ticks_b Ticks of the left-hand wheel during the sample.
+ */
+void dead_reckoning_update(struct dead_reckoning *dr, const struct dead_reckoning_geometry *geo,
+			   int32_t ticks_a, int32_t ticks_b);
+
+/** @brief Get the distance travelled.
+ *
+ *  @param[in] dr Integrator.
+ *  @param[in] geo Geometry of the drive.
+ *
+ *  @return Distance along the path [m], negative when reversing.
+ */
+float dead_reckoning_distance(const struct dead_reckoning *dr,
+			      const struct dead_reckoning_geometry *geo);
+
+/** @brief Get the heading.
+ *
+ *  @param[in] dr Integrator.
+ *
+ *  @return Heading in [-pi, pi) [rad].
+ */
+float dead_reckoning_heading(const struct dead_reckoning *dr);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* _DEAD_RECKONING_H_ */
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <string.h>
+#include "latency_hist.h"
+
+#if IS_ENABLED(CONFIG_LATENCY_HIST_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
+
+static struct latency_hist hists[LATENCY_STAGE_COUNT];
+
+void latency_hist_add(enum latency_stage stage, uint32_t since)
+{
+	struct latency_hist *hist = &hists[stage];
+	uint32_t cycles = k_cycle_get_32() - since;
+	/* Index of the highest set bit plus one, 0 for no latency. */
+	uint32_t bucket = cycles ? (32 - __builtin_clz(cycles)) : 0;
+
+	hist->buckets[MIN(bucket, LATENCY_HIST_BUCKETS - 1)]++;
+	hist->count++;
+	if (cycles > hist->max_cycles) {
+		hist->max_cycles = cycles;
+	}
+}
+
+void latency_hist_get(enum latency_stage stage, struct latency_hist *hist)
+{
+	__ASSERT_NO_MSG(stage < LATENCY_STAGE_COUNT);
+
+	unsigned int key = irq_lock();
+
+	*hist = hists[stage];
+	irq_unlock(key);
+}
+
+void latency_hist_reset(void)
+{
+	unsigned int key = irq_lock();
+
+	memset(hists, 0, sizeof(hists));
+	irq_unlock(key);
+}
+
+#if IS_ENABLED(CONFIG_LATENCY_HIST_SHELL)
+
+static const char *const stage_names[] = {
+	[LATENCY_EDGE_TO_FETCH] = "edge to fetch",
+	[LATENCY_FETCH_TO_SUBMIT] = "fetch to submit",
+	[LATENCY_SUBMIT_TO_REPORT] = "submit to report",
+	[LATENCY_REPORT_TO_SENT] = "report to sent",
+	[LATENCY_TOTAL] = "total",
+};
+
+BUILD_ASSERT(ARRAY_SIZE(stage_names) == LATENCY_STAGE_COUNT);
+
+static int cmd_show(const struct shell *sh, size_t argc, char **argv)
+{
+	struct latency_hist hist;
+
+	for (size_t stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+		latency_hist_get(stage, &hist);
+		shell_print(sh, "%s: %u samples, max %u us", stage_names[stage],
+			    hist.count, k_cyc_to_us_ceil32(hist.max_cycles));
+		for (size_t i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+			if (!hist.buckets[i]) {
+				continue;
+			}
+			shell_print(sh, "  < %8u us: %u",
+				    (i < LATENCY_HIST_BUCKETS - 1) ?
+					k_cyc_to_us_ceil32(BIT(i)) : UINT32_MAX,
+				    hist.buckets[i]);
+		}
+	}
+	return 0;
+}
+
+static int cmd_reset(const struct shell *sh, size_t argc, char **argv)
+{
+	latency_hist_reset();
+	shell_print(sh, "Latency histograms cleared");
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_latency,
+	SHELL_CMD(show, NULL, "Print the latency histograms", cmd_show),
+	SHELL_CMD(reset, NULL, "Clear the latency histograms", cmd_reset),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(latency, &sub_latency, "Report pipeline latencies", NULL);
+
+#endif /* CONFIG_LATENCY_HIST_SHELL */
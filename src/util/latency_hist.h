@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _LATENCY_HIST_H_
+#define _LATENCY_HIST_H_
+
+/**@file
+ *@brief Latency histogram library header.
+ */
+
+#include <zephyr/kernel.h>
+
+/**
+ * @defgroup latency_hist Latency histogram library
+ * @{
+ * @brief Histograms of the latency of each stage of the report pipeline.
+ *
+ * Timestamps are hardware cycle counts from k_cycle_get_32(). Bucket n
+ * counts latencies of 2^(n-1) to 2^n - 1 cycles, bucket 0 counts zero
+ * latencies, and the last bucket everything above. Each stage must only be
+ * added to from one context. The histograms are read with the 'latency'
+ * shell command. On the nRF52 the cycle counter runs at 32768 Hz, so the
+ * resolution is about 30 us.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Stages of the report pipeline. */
+enum latency_stage {
+	/** First encoder edge of a sample to the sample fetch. */
+	LATENCY_EDGE_TO_FETCH,
+	/** Sample fetch to the submit of the encoder event. */
+	LATENCY_FETCH_TO_SUBMIT,
+	/** Encoder event submit to the HID report being built. */
+	LATENCY_SUBMIT_TO_REPORT,
+	/** HID report built to the notification completion. */
+	LATENCY_REPORT_TO_SENT,
+	/** First encoder edge to the notification completion. */
+	LATENCY_TOTAL,
+
+	LATENCY_STAGE_COUNT,
+};
+
+/** @brief Number of buckets in each histogram. */
+#define LATENCY_HIST_BUCKETS 24
+
+/** @brief Histogram of one stage. */
+struct latency_hist {
+	uint32_t buckets[LATENCY_HIST_BUCKETS];
+	uint32_t count;
+	uint32_t max_cycles;
+};
+
+#if IS_ENABLED(CONFIG_LATENCY_HIST)
+
+/** @brief Current timestamp for the latency histograms. */
+static inline uint32_t latency_stamp(void)
+{
+	return k_cycle_get_32();
+}
+
+/** @brief Add the latency from a timestamp until now to a histogram.
+ *
+ *  @param stage Pipeline stage.
+ *  @param since Timestamp from @ref latency_stamp at the start of the stage.
+ */
+void latency_hist_add(enum latency_stage stage, uint32_t since);
+
+/** @brief Copy the histogram of a stage.
+ *
+ *  @param stage Pipeline stage.
+ *  @param[out] hist Histogram.
+ */
+void latency_hist_get(enum latency_stage stage, struct latency_hist *hist);
+
+/** @brief Clear all histograms. */
+void latency_hist_reset(void);
+
+#else
+
+static inline uint32_t latency_stamp(void) { return 0; }
+static inline void latency_hist_add(enum latency_stage stage, uint32_t since) {}
+
+#endif /* CONFIG_LATENCY_HIST */
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* _LATENCY_HIST_H_ */
@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <stdio.h>
+#include <string.h>
+#include "param_store.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(param_store, CONFIG_PARAM_STORE_LOG_LEVEL);
+
+#define SUBTREE "ergo"
+#define KEY_MAX_LEN 16
+
+struct param_entry {
+	/* Current value, returned by param_store_get. */
+	uint8_t data[CONFIG_PARAM_STORE_BLOB_MAX_SIZE];
+	size_t len;
+	/* Value last written to or read from flash. */
+	uint8_t stored[CONFIG_PARAM_STORE_BLOB_MAX_SIZE];
+	size_t stored_len;
+	bool dirty;
+	atomic_t generation;
+};
+
+static struct param_entry entries[PARAM_STORE_COUNT];
+
+/* Protects entries and the fields below. Until loaded is set, entries
+ * belong to the load work and are not touched by any other function.
+ */
+static K_MUTEX_DEFINE(store_mutex);
+static atomic_t loaded;
+static bool load_started;
+static bool commit_pending;
+static int64_t first_dirty_time;
+static struct param_store_stats stats;
+
+static K_THREAD_STACK_DEFINE(store_stack, CONFIG_PARAM_STORE_THREAD_STACK_SIZE);
+static struct k_work_q store_work_q;
+
+static void load_work_handler(struct k_work *work);
+static K_WORK_DEFINE(load_work, load_work_handler);
+
+static void commit_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(commit_work, commit_work_handler);
+
+/* Writes the settings key of an entry, relative to the subtree. */
+static void entry_name(size_t id, char *buf, size_t size)
+{
+	switch (id) {
+	case PARAM_STORE_HID:
+		snprintf(buf, size, "hid");
+		break;
+	case PARAM_STORE_ENCODER:
+		snprintf(buf, size, "enc");
+		break;
+	case PARAM_STORE_HID_MAP:
+		snprintf(buf, size, "map");
+		break;
+	default:
+		snprintf(buf, size, "prof%u", id - PARAM_STORE_PROFILE_FIRST);
+		break;
+	}
+}
+
+static struct param_entry *find_entry(const char *name)
+{
+	char buf[KEY_MAX_LEN];
+
+	for (size_t i = 0; i < ARRAY_SIZE(entries); i++) {
+		entry_name(i, buf, sizeof(buf));
+		if (strcmp(buf, name) == 0) {
+			return &entries[i];
+		}
+	}
+	return NULL;
+}
+
+static int direct_loader(const char *key, size_t len, settings_read_cb read_cb,
+			 void *cb_arg, void *param)
+{
+	struct param_entry *entry = find_entry(key);
+	ssize_t rc;
+
+	if (entry == NULL || len == 0 || len > sizeof(entry->data)) {
+		/* Unknown, deleted or oversized entry. */
+		return 0;
+	}
+
+	rc = read_cb(cb_arg, entry->data, len);
+	if (rc < 0) {
+		LOG_ERR("Failed to read %s/%s, error: %d", SUBTREE, key, rc);
+		return 0;
+	}
+
+	entry->len = rc;
+	memcpy(entry->stored, entry->data, rc);
+	entry->stored_len = rc;
+	return 0;
+}
+
+static void load_work_handler(struct k_work *work)
+{
+	uint32_t start = k_cycle_get_32();
+	int err;
+
+	err = settings_subsys_init();
+	if (!err) {
+		err = settings_load_subtree_direct(SUBTREE, direct_loader, NULL);
+	}
+
+	k_mutex_lock(&store_mutex, K_FOREVER);
+	stats.load_time_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+	for (size_t i = 0; i < ARRAY_SIZE(entries); i++) {
+		if (entries[i].len) {
+			atomic_inc(&entries[i].generation);
+		}
+	}
+	/* Defaults stay in use if the load failed, updates are stored. */
+	atomic_set(&loaded, true);
+	k_mutex_unlock(&store_mutex);
+
+	if (err) {
+		LOG_ERR("Failed to load settings subtree, error: %d", err);
+		return;
+	}
+	LOG_INF("Parameters loaded in %u us", stats.load_time_us);
+}
+
+int param_store_load(void)
+{
+	k_mutex_lock(&store_mutex, K_FOREVER);
+	if (!load_started) {
+		load_started = true;
+		k_work_queue_start(&store_work_q, store_stack,
+				   K_THREAD_STACK_SIZEOF(store_stack),
+				   K_LOWEST_APPLICATION_THREAD_PRIO, NULL);
+		k_thread_name_set(&store_work_q.thread, "param_store");
+		k_work_submit_to_queue(&store_work_q, &load_work);
+	}
+	k_mutex_unlock(&store_mutex);
+
+	return 0;
+}
+
+bool param_store_loaded(void)
+{
+	return atomic_get(&loaded);
+}
+
+int param_store_get(enum param_store_id id, void *data, size_t len)
+{
+	struct param_entry *entry = &entries[id];
+	int err = -ENOENT;
+
+	__ASSERT_NO_MSG(id < PARAM_STORE_COUNT);
+
+	if (!atomic_get(&loaded)) {
+		return -ENOENT;
+	}
+
+	k_mutex_lock(&store_mutex, K_FOREVER);
+	if (entry->len == len) {
+		memcpy(data, entry->data, len);
+		err = 0;
+	}
+	k_mutex_unlock(&store_mutex);
+
+	return err;
+}
+
+int param_store_set(enum param_store_id id, const void *data, size_t len)
+{
+	struct param_entry *entry = &entries[id];
+	int64_t now = k_uptime_get();
+	int64_t deadline;
+
+	__ASSERT_NO_MSG(id < PARAM_STORE_COUNT);
+
+	if (len > sizeof(entry->data)) {
+		return -EMSGSIZE;
+	}
+
+	k_mutex_lock(&store_mutex, K_FOREVER);
+	if (!atomic_get(&loaded)) {
+		/* Would be overwritten by the load in progress. */
+		k_mutex_unlock(&store_mutex);
+		return -EAGAIN;
+	}
+	memcpy(entry->data, data, len);
+	entry->len = len;
+	atomic_inc(&entry->generation);
+
+	if (entry->dirty) {
+		stats.coalesced++;
+	}
+	entry->dirty = true;
+
+	if (!commit_pending) {
+		commit_pending = true;
+		first_dirty_time = now;
+	}
+
+	/* Every update pushes the commit out, but never past the max delay
+	 * measured from the first uncommitted update.
+	 */
+	deadline = MIN(now + CONFIG_PARAM_STORE_COMMIT_DELAY_MS,
+		       first_dirty_time + CONFIG_PARAM_STORE_COMMIT_MAX_DELAY_MS);
+	k_work_reschedule_for_queue(&store_work_q, &commit_work,
+				    K_MSEC(MAX(deadline - now, 0)));
+	k_mutex_unlock(&store_mutex);
+
+	return 0;
+}
+
+uint32_t param_store_generation(enum param_store_id id)
+{
+	__ASSERT_NO_MSG(id < PARAM_STORE_COUNT);
+
+	return atomic_get(&entries[id].generation);
+}
+
+void param_store_stats_get(struct param_store_stats *out)
+{
+	k_mutex_lock(&store_mutex, K_FOREVER);
+	*out = stats;
+	k_mutex_unlock(&store_mutex);
+}
+
+static void commit_entry(struct param_entry *entry)
+{
+	uint8_t buf[CONFIG_PARAM_STORE_BLOB_MAX_SIZE];
+	char name[KEY_MAX_LEN];
+	char key[sizeof(SUBTREE) + KEY_MAX_LEN];
+	size_t len;
+	int err;
+
+	k_mutex_lock(&store_mutex, K_FOREVER);
+	if (!entry->dirty) {
+		k_mutex_unlock(&store_mutex);
+		return;
+	}
+	entry->dirty = false;
+	if (entry->len == entry->stored_len &&
+	    memcmp(entry->data, entry->stored, entry->len) == 0) {
+		/* Changed back to the stored value, nothing to write. */
+		k_mutex_unlock(&store_mutex);
+		return;
+	}
+	len = entry->len;
+	memcpy(buf, entry->data, len);
+	k_mutex_unlock(&store_mutex);
+
+	entry_name(entry - entries, name, sizeof(name));
+	snprintf(key, sizeof(key), SUBTREE "/%s", name);
+	err = settings_save_one(key, buf, len);
+
+	k_mutex_lock(&store_mutex, K_FOREVER);
+	if (err) {
+		LOG_ERR("Failed to store %s, error: %d", key, err);
+	} else {
+		memcpy(entry->stored, buf, len);
+		entry->stored_len = len;
+		stats.flash_writes++;
+		LOG_INF("Stored %s, %u flash writes since boot", key, stats.flash_writes);
+	}
+	k_mutex_unlock(&store_mutex);
+}
+
+static void commit_work_handler(struct k_work *work)
+{
+	k_mutex_lock(&store_mutex, K_FOREVER);
+	commit_pending = false;
+	k_mutex_unlock(&store_mutex);
+
+	for (size_t i = 0; i < ARRAY_SIZE(entries); i++) {
+		commit_entry(&entries[i]);
+	}
+}
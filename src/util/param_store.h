@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _PARAM_STORE_H_
+#define _PARAM_STORE_H_
+
+/**@file
+ *@brief Parameter store library header.
+ */
+
+#include <zephyr/kernel.h>
+
+/**
+ * @defgroup param_store Parameter store library
+ * @{
+ * @brief Keeps runtime-tunable parameter blobs in RAM and persists them in
+ *	  the "ergo" settings subtree.
+ *
+ * Each entry is stored as a single settings key holding a binary blob. The
+ * whole subtree is read once with a direct loader, so no settings handler
+ * is called for these keys during the global settings_load(). The read and
+ * the commits to flash are done from a low priority work queue. Writes only
+ * update the RAM copy; the commit is delayed and coalesced.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(CONFIG_HID_MODULE_PROFILE_COUNT)
+#define PARAM_STORE_PROFILE_COUNT CONFIG_HID_MODULE_PROFILE_COUNT
+#else
+#define PARAM_STORE_PROFILE_COUNT 0
+#endif
+
+/** @brief Parameter blobs kept by the store. */
+enum param_store_id {
+	/** HID module tuning parameters, settings key "ergo/hid". */
+	PARAM_STORE_HID,
+	/** Encoder module parameters, settings key "ergo/enc". */
+	PARAM_STORE_ENCODER,
+	/** HID module axis mapping, settings key "ergo/map". */
+	PARAM_STORE_HID_MAP,
+	/** First per-peer HID profile, settings keys "ergo/prof0" and up. */
+	PARAM_STORE_PROFILE_FIRST,
+
+	PARAM_STORE_COUNT = PARAM_STORE_PROFILE_FIRST + PARAM_STORE_PROFILE_COUNT,
+};
+
+/** @brief Statistics of the parameter store. */
+struct param_store_stats {
+	/* Number of blobs written to flash since boot. */
+	uint32_t flash_writes;
+	/* Number of parameter updates merged into a later flash write. */
+	uint32_t coalesced;
+	/* Duration of the initial load of the settings subtree. */
+	uint32_t load_time_us;
+};
+
+#if IS_ENABLED(CONFIG_PARAM_STORE)
+
+/** @brief Start loading all parameter blobs from settings.
+ *
+ *  The blobs are read on the work queue of the store, and the function
+ *  returns without waiting for it. Only the first call has any effect.
+ *  Call it once the settings subsystem is initialized, that is when the
+ *  CAF settings loader is ready.
+ *
+ *  Until the load is done, @ref param_store_get returns -ENOENT and
+ *  @ref param_store_set returns -EAGAIN. Users start from their defaults
+ *  and pick up the stored blobs through @ref param_store_generation, which
+ *  the load increments for every blob it read.
+ *
+ *  @return 0 if successful, otherwise a negative error code.
+ */
+int param_store_load(void);
+
+/** @brief Check if the parameter blobs have been loaded.
+ *
+ *  @return true once the load started by @ref param_store_load is done.
+ */
+bool param_store_loaded(void);
+
+/** @brief Copy a parameter blob from the store.
+ *
+ *  @param[in] id Parameter blob to read.
+ *  @param[out] data Buffer the blob will be written to.
+ *  @param[in] len Expected length of the blob.
+ *
+ *  @return 0 if successful, -ENOENT if nothing with this length is stored.
+ */
+int param_store_get(enum param_store_id id, void *data, size_t len);
+
+/** @brief Update a parameter blob and schedule it for storage.
+ *
+ *  @param[in] id Parameter blob to write.
+ *  @param[in] data New value of the blob.
+ *  @param[in] len Length of the blob.
+ *
+ *  @return 0 if successful, otherwise a negative error code.
+ */
+int param_store_set(enum param_store_id id, const void *data, size_t len);
+
+/** @brief Get the generation of a parameter blob.
+ *
+ *  The generation is incremented on every call to @ref param_store_set and
+ *  when the blob is loaded from flash, which lets a user detect changes
+ *  without registering a callback.
+ *
+ *  @param[in] id Parameter blob.
+ *
+ *  @return Current generation of the blob.
+ */
+uint32_t param_store_generation(enum param_store_id id);
+
+/** @brief Get statistics of the parameter store.
+ *
+ *  @param[out] stats Statistics.
+ */
+void param_store_stats_get(struct param_store_stats *stats);
+
+#else
+
+static inline int param_store_load(void) { return -ENOTSUP; }
+static inline bool param_store_loaded(void) { return false; }
+static inline int param_store_get(enum param_store_id id, void *data, size_t len)
+{
+	return -ENOTSUP;
+}
+static inline int param_store_set(enum param_store_id id, const void *data, size_t len)
+{
+	return -ENOTSUP;
+}
+static inline uint32_t param_store_generation(enum param_store_id id) { return 0; }
+static inline void param_store_stats_get(struct param_store_stats *stats) {}
+
+#endif /* IS_ENABLED(CONFIG_PARAM_STORE) */
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* _PARAM_STORE_H_ */
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include "predictor.h"
+
+#define N CONFIG_PREDICTOR_HISTORY
+
+/* Sample times are centered, t = i - (N-1)/2, so the fit is
+ * y = mean + slope*t with slope = sum(t*y)/sum(t*t).
+ */
+#define T_CENTER ((N - 1) / 2.0f)
+#define T_SQUARE_SUM ((float)N * (N * N - 1) / 12.0f)
+
+BUILD_ASSERT(N >= 2, "At least two samples are needed for a slope");
+
+void predictor_coeffs_compute(float horizon_s, float max_lead, float sample_period_s,
+			      struct predictor_coeffs *coeffs)
+{
+	coeffs->horizon = horizon_s / sample_period_s;
+	coeffs->max_lead = max_lead;
+}
+
+void predictor_reset(struct predictor_state *state)
+{
+	for (size_t i = 0; i < N; i++) {
+		state->samples[i] = 0.0f;
+	}
+	state->oldest = 0;
+}
+
+float predictor_run(const struct predictor_coeffs *coeffs, struct predictor_state *state, float x)
+{
+	float sum = 0.0f;
+	float weighted_sum = 0.0f;
+	float slope, fit, lead, prediction;
+	size_t idx = state->oldest;
+
+	state->samples[idx] = x;
+	state->oldest = (idx + 1) % N;
+
+	for (size_t i = 0; i < N; i++) {
+		float y = state->samples[(state->oldest + i) % N];
+
+		sum += y;
+		weighted_sum += ((float)i - T_CENTER) * y;
+	}
+	slope = weighted_sum / T_SQUARE_SUM;
+	fit = sum / N + slope * T_CENTER;
+
+	/* Extrapolate from the fitted line, bounded relative to the newest sample. */
+	lead = fit + slope * coeffs->horizon - x;
+	prediction = x + CLAMP(lead, -coeffs->max_lead, coeffs->max_lead);
+
+	/* A signal slowing towards zero is predicted to stop at zero, not reverse. */
+	return (prediction * x < 0.0f) ? 0.0f : prediction;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _PREDICTOR_H_
+#define _PREDICTOR_H_
+
+/**@file
+ *@brief Predictor library header.
+ */
+
+#include <zephyr/types.h>
+#include <zephyr/sys/util.h>
+
+/**
+ * @defgroup predictor Predictor library
+ * @{
+ * @brief Linear extrapolation of a uniformly sampled signal.
+ *
+ * A least-squares line is fitted to the last CONFIG_PREDICTOR_HISTORY
+ * samples and evaluated a fixed horizon ahead of the newest sample. The
+ * lead over the newest sample is bounded, and the prediction never crosses
+ * zero, so that a signal coming to rest is not overshot.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Coefficients of a predictor. */
+struct predictor_coeffs {
+	/* Distance from the newest sample to the predicted point [samples] */
+	float horizon;
+	/* Largest difference between the prediction and the newest sample */
+	float max_lead;
+};
+
+#if IS_ENABLED(CONFIG_PREDICTOR)
+
+/** @brief State of a predictor. */
+struct predictor_state {
+	float samples[CONFIG_PREDICTOR_HISTORY];
+	/* Index of the oldest sample */
+	uint8_t oldest;
+};
+
+/** @brief Compute the coefficients of a predictor.
+ *
+ *  @param[in] horizon_s Time to extrapolate ahead in seconds.
+ *  @param[in] max_lead Largest difference between the prediction and the newest sample.
+ *  @param[in] sample_period_s Time between samples in seconds.
+ *  @param[out] coeffs Coefficients.
+ */
+void predictor_coeffs_compute(float horizon_s, float max_lead, float sample_period_s,
+			      struct predictor_coeffs *coeffs);
+
+/** @brief Reset a predictor to a signal at rest.
+ *
+ *  @param[out] state Predictor state.
+ */
+void predictor_reset(struct predictor_state *state);
+
+/** @brief Add a sample and get the predicted value.
+ *
+ *  @param[in] coeffs Coefficients.
+ *  @param[in,out] state Predictor state.
+ *  @param[in] x Newest sample.
+ *
+ *  @return Predicted value.
+ */
+float predictor_run(const struct predictor_coeffs *coeffs, struct predictor_state *state, float x);
+
+#endif /* IS_ENABLED(CONFIG_PREDICTOR) */
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* _PREDICTOR_H_ */
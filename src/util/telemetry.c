@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/sys/ring_buffer.h>
+#include "telemetry.h"
+
+#if IS_ENABLED(CONFIG_TELEMETRY_BACKEND_RTT)
+#include <SEGGER_RTT.h>
+#else
+#include <zephyr/drivers/uart.h>
+#endif
+
+#define SYNC_0 0xA5
+#define SYNC_1 0x5A
+#define HEADER_SIZE 10
+#define CRC_SIZE 2
+#define FRAME_MAX_SIZE (HEADER_SIZE + TELEMETRY_PAYLOAD_MAX_SIZE + CRC_SIZE)
+
+RING_BUF_DECLARE(frame_ring, CONFIG_TELEMETRY_BUFFER_SIZE);
+
+/* Only accessed by the writer. */
+static uint16_t sequence;
+
+/* Written by the writer, read from any context. */
+static struct telemetry_stats stats;
+static struct k_spinlock stats_lock;
+
+#if IS_ENABLED(CONFIG_TELEMETRY_BACKEND_RTT)
+
+static uint8_t rtt_buf[CONFIG_TELEMETRY_RTT_BUFFER_SIZE];
+
+static void backend_init(void)
+{
+	SEGGER_RTT_ConfigUpBuffer(CONFIG_TELEMETRY_RTT_CHANNEL, "Telemetry", rtt_buf,
+				  sizeof(rtt_buf), SEGGER_RTT_MODE_NO_BLOCK_TRIM);
+}
+
+/* Returns the number of bytes the backend accepted. */
+static uint32_t backend_write(const uint8_t *data, uint32_t len)
+{
+	return SEGGER_RTT_Write(CONFIG_TELEMETRY_RTT_CHANNEL, data, len);
+}
+
+#else
+
+#if DT_HAS_CHOSEN(ergo_telemetry_uart)
+#define TELEMETRY_UART DT_CHOSEN(ergo_telemetry_uart)
+#elif IS_ENABLED(CONFIG_UART_CONSOLE)
+#error "Choose ergo,telemetry-uart, the console UART is in use"
+#else
+#define TELEMETRY_UART DT_CHOSEN(zephyr_console)
+#endif
+
+static const struct device *uart_dev = DEVICE_DT_GET(TELEMETRY_UART);
+
+static void backend_init(void)
+{
+}
+
+static uint32_t backend_write(const uint8_t *data, uint32_t len)
+{
+	if (!device_is_ready(uart_dev)) {
+		return len;
+	}
+	for (uint32_t i = 0; i < len; i++) {
+		uart_poll_out(uart_dev, data[i]);
+	}
+	return len;
+}
+
+#endif /* IS_ENABLED(CONFIG_TELEMETRY_BACKEND_RTT) */
+
+int telemetry_write(enum telemetry_frame_type type, const void *payload, size_t len)
+{
+	uint32_t start = k_cycle_get_32();
+	uint8_t frame[FRAME_MAX_SIZE];
+	size_t size = HEADER_SIZE + len + CRC_SIZE;
+	k_spinlock_key_t key;
+	uint32_t cycles;
+	int err = 0;
+
+	__ASSERT_NO_MSG(len <= TELEMETRY_PAYLOAD_MAX_SIZE);
+
+	frame[0] = SYNC_0;
+	frame[1] = SYNC_1;
+	frame[2] = type;
+	frame[3] = len;
+	sys_put_le16(sequence++, &frame[4]);
+	sys_put_le32(k_uptime_get_32(), &frame[6]);
+	memcpy(&frame[HEADER_SIZE], payload, len);
+	sys_put_le16(crc16_ccitt(0xFFFF, &frame[2], HEADER_SIZE - 2 + len),
+		     &frame[HEADER_SIZE + len]);
+
+	/* Never write a partial frame, so that the stream stays decodable. */
+	if (ring_buf_space_get(&frame_ring) < size) {
+		err = -ENOMEM;
+	} else {
+		ring_buf_put(&frame_ring, frame, size);
+	}
+
+	cycles = k_cycle_get_32() - start;
+	key = k_spin_lock(&stats_lock);
+	if (err) {
+		stats.dropped++;
+	} else {
+		stats.frames++;
+	}
+	stats.write_cycles += cycles;
+	stats.write_cycles_max = MAX(stats.write_cycles_max, cycles);
+	k_spin_unlock(&stats_lock, key);
+
+	return err;
+}
+
+void telemetry_stats_get(struct telemetry_stats *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	*out = stats;
+	k_spin_unlock(&stats_lock, key);
+}
+
+static void telemetry_thread_fn(void)
+{
+	backend_init();
+
+	while (true) {
+		uint8_t *data;
+		uint32_t len = ring_buf_get_claim(&frame_ring, &data, CONFIG_TELEMETRY_BUFFER_SIZE);
+		uint32_t written = 0;
+
+		if (len) {
+			written = backend_write(data, len);
+		}
+		ring_buf_get_finish(&frame_ring, written);
+
+		if (written < len || ring_buf_is_empty(&frame_ring)) {
+			k_sleep(K_MSEC(CONFIG_TELEMETRY_FLUSH_INTERVAL_MS));
+		}
+	}
+}
+
+K_THREAD_DEFINE(telemetry_thread, CONFIG_TELEMETRY_THREAD_STACK_SIZE, telemetry_thread_fn,
+		NULL, NULL, NULL, K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
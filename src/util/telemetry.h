@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+/**@file
+ *@brief Telemetry library header.
+ */
+
+#include <zephyr/kernel.h>
+
+/**
+ * @defgroup telemetry Telemetry library
+ * @{
+ * @brief Fixed-layout binary frames for plotting, sent without blocking.
+ *
+ * A frame is copied into a ring buffer, which a thread of the lowest
+ * application priority drains to the backend (RTT or UART). The writer
+ * never waits for the backend; a frame that does not fit is dropped and
+ * counted. Frames are decoded on the host by scripts/telemetry_decode.py.
+ *
+ * Frame layout, all fields in little endian:
+ *
+ *	offset	size	field
+ *	0	2	sync, 0xA5 0x5A
+ *	2	1	type, see @ref telemetry_frame_type
+ *	3	1	payload length
+ *	4	2	sequence number, incremented per frame written
+ *	6	4	uptime when the frame was written [ms]
+ *	10	len	payload
+ *	10+len	2	CRC-16/CCITT (seed 0xFFFF) over type to end of payload
+ *
+ * The ring buffer has a single writer: frames must only be written from one
+ * context, e.g. the application event handlers.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Types of the telemetry frames, one payload layout each. */
+enum telemetry_frame_type {
+	/** Intermediate values of the HID module, struct hid_telemetry. */
+	TELEMETRY_FRAME_HID = 1,
+};
+
+/** @brief Largest payload of a frame in bytes. */
+#define TELEMETRY_PAYLOAD_MAX_SIZE 64
+
+/** @brief Statistics of the telemetry stream. */
+struct telemetry_stats {
+	/* Frames written to the buffer since boot. */
+	uint32_t frames;
+	/* Frames dropped because the buffer was full. */
+	uint32_t dropped;
+	/* Cycles spent in telemetry_write, summed and worst case. */
+	uint64_t write_cycles;
+	uint32_t write_cycles_max;
+};
+
+#if IS_ENABLED(CONFIG_TELEMETRY)
+
+/** @brief Write a frame to the telemetry stream.
+ *
+ *  Returns immediately, the frame is sent by the telemetry thread.
+ *
+ *  @param[in] type Type of the frame.
+ *  @param[in] payload Payload of the frame.
+ *  @param[in] len Length of the payload, at most TELEMETRY_PAYLOAD_MAX_SIZE.
+ *
+ *  @return 0 if successful, -ENOMEM if the frame was dropped.
+ */
+int telemetry_write(enum telemetry_frame_type type, const void *payload, size_t len);
+
+/** @brief Get statistics of the telemetry stream.
+ *
+ *  @param[out] stats Statistics.
+ */
+void telemetry_stats_get(struct telemetry_stats *stats);
+
+#else
+
+static inline int telemetry_write(enum telemetry_frame_type type, const void *payload,
+				  size_t len)
+{
+	return -ENOTSUP;
+}
+static inline void telemetry_stats_get(struct telemetry_stats *stats) {}
+
+#endif /* IS_ENABLED(CONFIG_TELEMETRY) */
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* _TELEMETRY_H_ */
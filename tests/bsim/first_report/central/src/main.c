@@ -0,0 +1,376 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**
+ * Host side of the first report test.
+ *
+ * Behaves like a game PC: finds the device, pairs, subscribes to the game
+ * pad report and waits for the first one, which gives the time from boot
+ * to the first report. It then stays connected while the device goes idle,
+ * disconnects as when the PC sleeps, and connects again without touching
+ * the subscription. The time from that connection to the first report
+ * shows the reconnect path: directed advertising, encryption with the
+ * stored keys and the report sent on PEER_STATE_SECURED.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+
+#include "bstests.h"
+#include "bs_types.h"
+#include "bs_tracing.h"
+
+extern enum bst_result_t bst_result;
+
+#define PASS(...)                                \
+    do                                           \
+    {                                            \
+        bst_result = Passed;                     \
+        bs_trace_info_time(1, __VA_ARGS__);      \
+    } while (0)
+
+#define FAIL(...)                                \
+    do                                           \
+    {                                            \
+        bst_result = Failed;                     \
+        bs_trace_error_time_line(__VA_ARGS__);   \
+    } while (0)
+
+/* Simulated time after which a missing verdict fails the test [us]. */
+#define WAIT_TIME_US (60 * USEC_PER_SEC)
+/* Longer than CONFIG_APP_MODULE_IDLE_TIMEOUT_MSEC of the device, so it has
+ * paused sampling and only the report sent on securing can arrive.
+ */
+#define HOST_SLEEP_MS 10000
+/* Both devices boot at the start of the simulation. Includes pairing and
+ * discovery by this central, and one sampling period of the device.
+ */
+#define MAX_BOOT_TO_FIRST_REPORT_MS 3000
+/* Encryption with the stored keys takes a few 7.5 ms connection events,
+ * the report goes out in the next one.
+ */
+#define MAX_RECONNECT_TO_FIRST_REPORT_MS 200
+
+static struct bt_conn *default_conn;
+static bt_addr_le_t peer_addr;
+static bool bonded;
+static struct bt_gatt_discover_params discover_params;
+static struct bt_gatt_subscribe_params subscribe_params;
+
+static K_SEM_DEFINE(connected_sem, 0, 1);
+static K_SEM_DEFINE(disconnected_sem, 0, 1);
+static K_SEM_DEFINE(secured_sem, 0, 1);
+static K_SEM_DEFINE(discovered_sem, 0, 1);
+static K_SEM_DEFINE(report_sem, 0, 1);
+
+/* Written before connecting and by the Bluetooth RX thread. */
+static uint32_t connected_ms;
+static uint32_t first_report_ms;
+static atomic_t report_pending;
+static atomic_t disconnect_expected;
+
+static uint8_t notify_cb(struct bt_conn *conn, struct bt_gatt_subscribe_params *params,
+                         const void *data, uint16_t length)
+{
+    if (!data)
+    {
+        return BT_GATT_ITER_CONTINUE;
+    }
+    if (atomic_cas(&report_pending, true, false))
+    {
+        first_report_ms = k_uptime_get_32();
+        k_sem_give(&report_sem);
+    }
+    return BT_GATT_ITER_CONTINUE;
+}
+
+static uint8_t discover_cb(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                           struct bt_gatt_discover_params *params)
+{
+    if (!attr)
+    {
+        FAIL("Game pad report characteristic not found\n");
+        return BT_GATT_ITER_STOP;
+    }
+
+    const struct bt_gatt_chrc *chrc = attr->user_data;
+
+    /* The feature reports share the UUID, only the input report notifies. */
+    if (!(chrc->properties & BT_GATT_CHRC_NOTIFY))
+    {
+        return BT_GATT_ITER_CONTINUE;
+    }
+
+    subscribe_params.value_handle = chrc->value_handle;
+    /* The CCC descriptor directly follows the value. */
+    subscribe_params.ccc_handle = chrc->value_handle + 1;
+    k_sem_give(&discovered_sem);
+    return BT_GATT_ITER_STOP;
+}
+
+static bool ad_has_hid_service(struct bt_data *data, void *user_data)
+{
+    bool *found = user_data;
+
+    if (data->type == BT_DATA_UUID16_ALL)
+    {
+        for (size_t i = 0; i + 1 < data->data_len; i += 2)
+        {
+            if (sys_get_le16(&data->data[i]) == BT_UUID_HIDS_VAL)
+            {
+                *found = true;
+            }
+        }
+    }
+    return !*found;
+}
+
+static void device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t type,
+                         struct net_buf_simple *ad)
+{
+    bool found = false;
+    int err;
+
+    if (default_conn)
+    {
+        return;
+    }
+
+    if (bonded)
+    {
+        /* The device comes back with directed advertising, or with fast
+         * advertising once that times out.
+         */
+        if (bt_addr_le_cmp(addr, &peer_addr) ||
+            ((type != BT_GAP_ADV_TYPE_ADV_DIRECT_IND) && (type != BT_GAP_ADV_TYPE_ADV_IND)))
+        {
+            return;
+        }
+        bs_trace_raw_time(1, "Device found, %s advertising\n",
+                          (type == BT_GAP_ADV_TYPE_ADV_DIRECT_IND) ? "directed" : "undirected");
+    }
+    else
+    {
+        if (type != BT_GAP_ADV_TYPE_ADV_IND)
+        {
+            return;
+        }
+        bt_data_parse(ad, ad_has_hid_service, &found);
+        if (!found)
+        {
+            return;
+        }
+    }
+
+    err = bt_le_scan_stop();
+    if (err)
+    {
+        FAIL("Could not stop scanning (%d)\n", err);
+        return;
+    }
+
+    /* Shortest interval, like a game PC asks for. */
+    err = bt_conn_le_create(addr, BT_CONN_LE_CREATE_CONN,
+                            BT_LE_CONN_PARAM(6, 6, 0, 400), &default_conn);
+    if (err)
+    {
+        FAIL("Could not connect (%d)\n", err);
+    }
+}
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+    if (err)
+    {
+        FAIL("Connection failed (%u)\n", err);
+        return;
+    }
+    connected_ms = k_uptime_get_32();
+    bt_addr_le_copy(&peer_addr, bt_conn_get_dst(conn));
+    k_sem_give(&connected_sem);
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    if (!atomic_get(&disconnect_expected))
+    {
+        FAIL("Disconnected unexpectedly (0x%02x)\n", reason);
+        return;
+    }
+    bt_conn_unref(default_conn);
+    default_conn = NULL;
+    k_sem_give(&disconnected_sem);
+}
+
+static void security_changed(struct bt_conn *conn, bt_security_t level, enum bt_security_err err)
+{
+    if (err)
+    {
+        FAIL("Security failed (%d)\n", err);
+        return;
+    }
+    k_sem_give(&secured_sem);
+}
+
+BT_CONN_CB_DEFINE(conn_callbacks) = {
+    .connected = connected,
+    .disconnected = disconnected,
+    .security_changed = security_changed,
+};
+
+/**
+ * @brief Scans for the device and connects with encryption.
+ *
+ * @return 0 when the link is encrypted, a negative error code otherwise
+ */
+static int connect_secured(void)
+{
+    int err;
+
+    err = bt_le_scan_start(BT_LE_SCAN_ACTIVE, device_found);
+    if (err)
+    {
+        FAIL("Scanning failed to start (%d)\n", err);
+        return err;
+    }
+    k_sem_take(&connected_sem, K_FOREVER);
+
+    /* Pairs on the first connection, encrypts with the bond afterwards. */
+    err = bt_conn_set_security(default_conn, BT_SECURITY_L2);
+    if (err)
+    {
+        FAIL("Security failed to start (%d)\n", err);
+        return err;
+    }
+    k_sem_take(&secured_sem, K_FOREVER);
+    return 0;
+}
+
+static void test_central_main(void)
+{
+    uint32_t boot_to_first_report_ms;
+    uint32_t reconnect_to_first_report_ms;
+    int err;
+
+    err = bt_enable(NULL);
+    if (err)
+    {
+        FAIL("Bluetooth init failed (%d)\n", err);
+        return;
+    }
+
+    atomic_set(&report_pending, true);
+    if (connect_secured())
+    {
+        return;
+    }
+    bonded = true;
+
+    discover_params.uuid = BT_UUID_HIDS_REPORT;
+    discover_params.func = discover_cb;
+    discover_params.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+    discover_params.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+    discover_params.type = BT_GATT_DISCOVER_CHARACTERISTIC;
+    err = bt_gatt_discover(default_conn, &discover_params);
+    if (err)
+    {
+        FAIL("Discovery failed to start (%d)\n", err);
+        return;
+    }
+    k_sem_take(&discovered_sem, K_FOREVER);
+
+    subscribe_params.notify = notify_cb;
+    subscribe_params.value = BT_GATT_CCC_NOTIFY;
+    err = bt_gatt_subscribe(default_conn, &subscribe_params);
+    if (err)
+    {
+        FAIL("Subscription failed (%d)\n", err);
+        return;
+    }
+    k_sem_take(&report_sem, K_FOREVER);
+    boot_to_first_report_ms = first_report_ms;
+    bs_trace_raw_time(1, "First report %u ms after boot\n", boot_to_first_report_ms);
+
+    k_sleep(K_MSEC(HOST_SLEEP_MS));
+    atomic_set(&disconnect_expected, true);
+    err = bt_conn_disconnect(default_conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+    if (err)
+    {
+        FAIL("Could not disconnect (%d)\n", err);
+        return;
+    }
+    k_sem_take(&disconnected_sem, K_FOREVER);
+    atomic_set(&disconnect_expected, false);
+
+    /* The subscription of a bonded peer is kept, the first notification
+     * on the new link is the report sent when it is secured.
+     */
+    atomic_set(&report_pending, true);
+    if (connect_secured())
+    {
+        return;
+    }
+    k_sem_take(&report_sem, K_FOREVER);
+    reconnect_to_first_report_ms = first_report_ms - connected_ms;
+    bs_trace_raw_time(1, "First report %u ms after reconnection\n", reconnect_to_first_report_ms);
+
+    if (boot_to_first_report_ms > MAX_BOOT_TO_FIRST_REPORT_MS)
+    {
+        FAIL("First report after %u ms, above %u ms\n", boot_to_first_report_ms,
+             MAX_BOOT_TO_FIRST_REPORT_MS);
+    }
+    else if (reconnect_to_first_report_ms > MAX_RECONNECT_TO_FIRST_REPORT_MS)
+    {
+        FAIL("First report %u ms after reconnection, above %u ms\n",
+             reconnect_to_first_report_ms, MAX_RECONNECT_TO_FIRST_REPORT_MS);
+    }
+    else
+    {
+        PASS("Reports arrived in time after boot and after reconnection\n");
+    }
+}
+
+static void test_central_init(void)
+{
+    bst_ticker_set_next_tick_absolute(WAIT_TIME_US);
+    bst_result = In_progress;
+}
+
+static void test_central_tick(bs_time_t HW_device_time)
+{
+    if (bst_result != Passed)
+    {
+        FAIL("No result after %u s\n", (uint32_t)(WAIT_TIME_US / USEC_PER_SEC));
+    }
+}
+
+static const struct bst_test_instance test_def[] = {
+    {
+        .test_id = "central",
+        .test_descr = "Measures the time to the first report after boot and reconnection",
+        .test_post_init_f = test_central_init,
+        .test_tick_f = test_central_tick,
+        .test_main_f = test_central_main,
+    },
+    BSTEST_END_MARKER
+};
+
+struct bst_test_list *test_central_install(struct bst_test_list *tests)
+{
+    return bst_add_tests(tests, test_def);
+}
+
+bst_test_install_t test_installers[] = {test_central_install, NULL};
+
+void main(void)
+{
+    bst_main();
+}
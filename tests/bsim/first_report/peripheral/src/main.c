@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**
+ * Device side of the first report test.
+ *
+ * Starts the modules of the application like its main does. CAF brings up
+ * Bluetooth, advertises and loads the settings, the HID module sends the
+ * game pad reports. The wheels stay still. The central measures when the
+ * reports arrive, this side only checks that the bonded central came back.
+ */
+
+#include <zephyr/kernel.h>
+
+#include <app_event_manager.h>
+#include <caf/events/ble_common_event.h>
+
+#define MODULE main
+#include <caf/events/module_state_event.h>
+
+#include "boot_trace.h"
+
+#include "bstests.h"
+#include "bs_types.h"
+#include "bs_tracing.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(MODULE);
+
+extern enum bst_result_t bst_result;
+
+#define PASS(...)                                \
+    do                                           \
+    {                                            \
+        bst_result = Passed;                     \
+        bs_trace_info_time(1, __VA_ARGS__);      \
+    } while (0)
+
+#define FAIL(...)                                \
+    do                                           \
+    {                                            \
+        bst_result = Failed;                     \
+        bs_trace_error_time_line(__VA_ARGS__);   \
+    } while (0)
+
+/* Only accessed from the system work queue. */
+static uint8_t secured_count;
+
+static bool app_event_handler(const struct app_event_header *aeh)
+{
+    if (is_ble_peer_event(aeh))
+    {
+        const struct ble_peer_event *event = cast_ble_peer_event(aeh);
+
+        if (event->state == PEER_STATE_SECURED)
+        {
+            secured_count++;
+            if (secured_count == 2)
+            {
+                PASS("Bonded central secured again\n");
+            }
+        }
+        return false;
+    }
+
+    /* Event not handled but subscribed. */
+    __ASSERT_NO_MSG(false);
+    return false;
+}
+
+APP_EVENT_LISTENER(MODULE, app_event_handler);
+APP_EVENT_SUBSCRIBE(MODULE, ble_peer_event);
+
+static void test_peripheral_init(void)
+{
+    bst_result = In_progress;
+}
+
+static void test_peripheral_main(void)
+{
+    boot_trace_mark("main");
+    if (app_event_manager_init())
+    {
+        FAIL("Application Event Manager not initialized\n");
+        return;
+    }
+    module_set_state(MODULE_STATE_READY);
+}
+
+static const struct bst_test_instance test_def[] = {
+    {
+        .test_id = "peripheral",
+        .test_descr = "Runs the encoder, HID and application modules with still wheels",
+        .test_post_init_f = test_peripheral_init,
+        .test_main_f = test_peripheral_main,
+    },
+    BSTEST_END_MARKER
+};
+
+struct bst_test_list *test_peripheral_install(struct bst_test_list *tests)
+{
+    return bst_add_tests(tests, test_def);
+}
+
+bst_test_install_t test_installers[] = {test_peripheral_install, NULL};
+
+void main(void)
+{
+    bst_main();
+}
@@ -0,0 +1,341 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**
+ * Host side of the stream throughput benchmark.
+ *
+ * Connects to the device, sets up the link like a recording client would,
+ * subscribes to the sample notifications and measures the sample rate, the
+ * payload throughput, sequence gaps and the drops reported by the device
+ * over MEASURE_TIME_MS of simulated time.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+
+#include "bstests.h"
+#include "bs_types.h"
+#include "bs_tracing.h"
+
+extern enum bst_result_t bst_result;
+
+#define PASS(...)                                \
+    do                                           \
+    {                                            \
+        bst_result = Passed;                     \
+        bs_trace_info_time(1, __VA_ARGS__);      \
+    } while (0)
+
+#define FAIL(...)                                \
+    do                                           \
+    {                                            \
+        bst_result = Failed;                     \
+        bs_trace_error_time_line(__VA_ARGS__);   \
+    } while (0)
+
+/* Simulated time after which a missing verdict fails the benchmark [us]. */
+#define WAIT_TIME_US (30 * USEC_PER_SEC)
+/* Notifications before this are ignored, the link is still being set up. */
+#define WARMUP_TIME_MS 2000
+#define MEASURE_TIME_MS 10000
+/* The device samples every millisecond and the wheels always move. */
+#define EXPECTED_SAMPLES_PER_SEC 1000
+#define MIN_SAMPLES_PER_SEC 990
+
+/* struct stream_header and struct stream_sample in src/modules/stream_module.c */
+#define STREAM_HEADER_SIZE 4
+#define STREAM_SAMPLE_SIZE 6
+
+/* Stream service 6e570000-7d3a-4b8e-9f1c-3b5d0c7a2e10 */
+static const uint8_t stream_service_uuid[] = {
+    BT_UUID_128_ENCODE(0x6e570000, 0x7d3a, 0x4b8e, 0x9f1c, 0x3b5d0c7a2e10)};
+
+/* Stream data characteristic 6e570001-7d3a-4b8e-9f1c-3b5d0c7a2e10 */
+static struct bt_uuid_128 stream_data_uuid = BT_UUID_INIT_128(
+    BT_UUID_128_ENCODE(0x6e570001, 0x7d3a, 0x4b8e, 0x9f1c, 0x3b5d0c7a2e10));
+
+static struct bt_conn *default_conn;
+static struct bt_gatt_discover_params discover_params;
+static struct bt_gatt_subscribe_params subscribe_params;
+static struct bt_gatt_exchange_params mtu_params;
+
+static K_SEM_DEFINE(connected_sem, 0, 1);
+static K_SEM_DEFINE(discovered_sem, 0, 1);
+
+/* Only accessed from the Bluetooth RX thread. */
+static struct
+{
+    bool started;
+    uint16_t next_sequence;
+    uint32_t window_start_ms;
+    uint32_t notifications;
+    uint32_t samples;
+    uint32_t payload_bytes;
+    uint32_t sequence_gaps;
+    uint32_t dropped;
+    uint16_t max_len;
+} bench;
+
+static atomic_t measure_done;
+
+static void report_results(uint32_t elapsed_ms)
+{
+    uint32_t samples_per_sec = bench.samples * MSEC_PER_SEC / elapsed_ms;
+    uint32_t bytes_per_sec = bench.payload_bytes * MSEC_PER_SEC / elapsed_ms;
+
+    bs_trace_raw_time(1, "%u notifications, %u samples in %u ms\n",
+                      bench.notifications, bench.samples, elapsed_ms);
+    bs_trace_raw_time(1, "%u samples/s of %u expected, %u B/s payload (%u kbit/s)\n",
+                      samples_per_sec, EXPECTED_SAMPLES_PER_SEC, bytes_per_sec,
+                      bytes_per_sec * 8 / 1000);
+    bs_trace_raw_time(1, "Largest notification %u B, %u sequence gaps, %u dropped\n",
+                      bench.max_len, bench.sequence_gaps, bench.dropped);
+
+    if (bench.sequence_gaps || bench.dropped)
+    {
+        FAIL("Samples were lost\n");
+    }
+    else if (samples_per_sec < MIN_SAMPLES_PER_SEC)
+    {
+        FAIL("Sample rate %u/s below %u/s\n", samples_per_sec, MIN_SAMPLES_PER_SEC);
+    }
+    else
+    {
+        PASS("Stream kept up with the sampling rate\n");
+    }
+}
+
+static uint8_t notify_cb(struct bt_conn *conn, struct bt_gatt_subscribe_params *params,
+                         const void *data, uint16_t length)
+{
+    uint32_t now = k_uptime_get_32();
+    uint16_t sequence;
+
+    if (!data || atomic_get(&measure_done))
+    {
+        return BT_GATT_ITER_CONTINUE;
+    }
+    if (length < STREAM_HEADER_SIZE)
+    {
+        FAIL("Notification of %u B is shorter than the header\n", length);
+        return BT_GATT_ITER_STOP;
+    }
+
+    sequence = sys_get_le16(data);
+    if (!bench.started)
+    {
+        if (now < WARMUP_TIME_MS)
+        {
+            bench.next_sequence = sequence + 1;
+            return BT_GATT_ITER_CONTINUE;
+        }
+        bench.started = true;
+        bench.window_start_ms = now;
+    }
+    else if (sequence != bench.next_sequence)
+    {
+        bench.sequence_gaps++;
+    }
+    bench.next_sequence = sequence + 1;
+
+    bench.notifications++;
+    bench.dropped += sys_get_le16((const uint8_t *)data + 2);
+    bench.samples += (length - STREAM_HEADER_SIZE) / STREAM_SAMPLE_SIZE;
+    bench.payload_bytes += length;
+    bench.max_len = MAX(bench.max_len, length);
+
+    if (now - bench.window_start_ms >= MEASURE_TIME_MS)
+    {
+        atomic_set(&measure_done, true);
+        report_results(now - bench.window_start_ms);
+    }
+    return BT_GATT_ITER_CONTINUE;
+}
+
+static uint8_t discover_cb(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                           struct bt_gatt_discover_params *params)
+{
+    if (!attr)
+    {
+        FAIL("Stream characteristic not found\n");
+        return BT_GATT_ITER_STOP;
+    }
+
+    const struct bt_gatt_chrc *chrc = attr->user_data;
+
+    subscribe_params.value_handle = chrc->value_handle;
+    /* The CCC descriptor directly follows the value. */
+    subscribe_params.ccc_handle = chrc->value_handle + 1;
+    k_sem_give(&discovered_sem);
+    return BT_GATT_ITER_STOP;
+}
+
+static void mtu_cb(struct bt_conn *conn, uint8_t err, struct bt_gatt_exchange_params *params)
+{
+    if (err)
+    {
+        FAIL("MTU exchange failed (%u)\n", err);
+    }
+}
+
+static bool ad_has_stream_service(struct bt_data *data, void *user_data)
+{
+    bool *found = user_data;
+
+    if (data->type == BT_DATA_UUID128_ALL && data->data_len == sizeof(stream_service_uuid))
+    {
+        *found = !memcmp(stream_service_uuid, data->data, sizeof(stream_service_uuid));
+    }
+    return !*found;
+}
+
+static void device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t type,
+                         struct net_buf_simple *ad)
+{
+    bool found = false;
+    int err;
+
+    if (default_conn || (type != BT_GAP_ADV_TYPE_ADV_IND))
+    {
+        return;
+    }
+
+    bt_data_parse(ad, ad_has_stream_service, &found);
+    if (!found)
+    {
+        return;
+    }
+
+    err = bt_le_scan_stop();
+    if (err)
+    {
+        FAIL("Could not stop scanning (%d)\n", err);
+        return;
+    }
+
+    /* Shortest interval, like a recording laptop asks for. */
+    err = bt_conn_le_create(addr, BT_CONN_LE_CREATE_CONN,
+                            BT_LE_CONN_PARAM(6, 6, 0, 400), &default_conn);
+    if (err)
+    {
+        FAIL("Could not connect (%d)\n", err);
+    }
+}
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+    if (err)
+    {
+        FAIL("Connection failed (%u)\n", err);
+        return;
+    }
+    k_sem_give(&connected_sem);
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    if (!atomic_get(&measure_done))
+    {
+        FAIL("Disconnected during the measurement (0x%02x)\n", reason);
+    }
+}
+
+BT_CONN_CB_DEFINE(conn_callbacks) = {
+    .connected = connected,
+    .disconnected = disconnected,
+};
+
+static void test_central_main(void)
+{
+    int err;
+
+    err = bt_enable(NULL);
+    if (err)
+    {
+        FAIL("Bluetooth init failed (%d)\n", err);
+        return;
+    }
+
+    err = bt_le_scan_start(BT_LE_SCAN_ACTIVE, device_found);
+    if (err)
+    {
+        FAIL("Scanning failed to start (%d)\n", err);
+        return;
+    }
+    k_sem_take(&connected_sem, K_FOREVER);
+
+    mtu_params.func = mtu_cb;
+    err = bt_gatt_exchange_mtu(default_conn, &mtu_params);
+    if (err)
+    {
+        FAIL("MTU exchange failed to start (%d)\n", err);
+        return;
+    }
+
+    discover_params.uuid = &stream_data_uuid.uuid;
+    discover_params.func = discover_cb;
+    discover_params.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+    discover_params.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+    discover_params.type = BT_GATT_DISCOVER_CHARACTERISTIC;
+    err = bt_gatt_discover(default_conn, &discover_params);
+    if (err)
+    {
+        FAIL("Discovery failed to start (%d)\n", err);
+        return;
+    }
+    k_sem_take(&discovered_sem, K_FOREVER);
+
+    /* The device asks for the data length and the PHY it needs itself. */
+    subscribe_params.notify = notify_cb;
+    subscribe_params.value = BT_GATT_CCC_NOTIFY;
+    err = bt_gatt_subscribe(default_conn, &subscribe_params);
+    if (err)
+    {
+        FAIL("Subscription failed (%d)\n", err);
+    }
+}
+
+static void test_central_init(void)
+{
+    bst_ticker_set_next_tick_absolute(WAIT_TIME_US);
+    bst_result = In_progress;
+}
+
+static void test_central_tick(bs_time_t HW_device_time)
+{
+    if (bst_result != Passed)
+    {
+        FAIL("No result after %u s\n", (uint32_t)(WAIT_TIME_US / USEC_PER_SEC));
+    }
+}
+
+static const struct bst_test_instance test_def[] = {
+    {
+        .test_id = "central",
+        .test_descr = "Measures the throughput of the raw encoder stream",
+        .test_post_init_f = test_central_init,
+        .test_tick_f = test_central_tick,
+        .test_main_f = test_central_main,
+    },
+    BSTEST_END_MARKER
+};
+
+struct bst_test_list *test_central_install(struct bst_test_list *tests)
+{
+    return bst_add_tests(tests, test_def);
+}
+
+bst_test_install_t test_installers[] = {test_central_install, NULL};
+
+void main(void)
+{
+    bst_main();
+}
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/**
+ * Device side of the stream throughput benchmark.
+ *
+ * Runs the stream module and the QDEC driver of the application. Both
+ * encoders are turned by a timer that toggles the emulated encoder lines,
+ * so every stream sample carries ticks. The central measures what arrives.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+#include <zephyr/bluetooth/bluetooth.h>
+
+#include <app_event_manager.h>
+#include <caf/events/ble_common_event.h>
+
+#define MODULE main
+#include <caf/events/module_state_event.h>
+
+#include "bstests.h"
+#include "bs_types.h"
+#include "bs_tracing.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(MODULE);
+
+extern enum bst_result_t bst_result;
+
+#define PASS(...)                                \
+    do                                           \
+    {                                            \
+        bst_result = Passed;                     \
+        bs_trace_info_time(1, __VA_ARGS__);      \
+    } while (0)
+
+#define FAIL(...)                                \
+    do                                           \
+    {                                            \
+        bst_result = Failed;                     \
+        bs_trace_error_time_line(__VA_ARGS__);   \
+    } while (0)
+
+/* Stream service 6e570000-7d3a-4b8e-9f1c-3b5d0c7a2e10 */
+#define BT_UUID_STREAM_SERVICE_VAL \
+    BT_UUID_128_ENCODE(0x6e570000, 0x7d3a, 0x4b8e, 0x9f1c, 0x3b5d0c7a2e10)
+
+/* Emulated lines, see nrf52_bsim.overlay. */
+#define ENCODER_A_LINE_A 0
+#define ENCODER_B_LINE_A 2
+
+static const struct device *gpio_dev = DEVICE_DT_GET(DT_NODELABEL(gpio_emul));
+
+static const struct bt_data ad[] = {
+    BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
+    BT_DATA_BYTES(BT_DATA_UUID128_ALL, BT_UUID_STREAM_SERVICE_VAL),
+};
+
+static const struct bt_data sd[] = {
+    BT_DATA(BT_DATA_NAME_COMPLETE, CONFIG_BT_DEVICE_NAME, sizeof(CONFIG_BT_DEVICE_NAME) - 1),
+};
+
+/**
+ * @brief Line levels of one quadrature step forward, line A then line B.
+ */
+static const uint8_t quadrature[4][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+
+/**
+ * @brief Moves both encoders CONFIG_BENCH_EDGES_PER_MS edges forward.
+ */
+static void wheel_timer_handler(struct k_timer *timer)
+{
+    static uint8_t phase;
+
+    for (int i = 0; i < CONFIG_BENCH_EDGES_PER_MS; i++)
+    {
+        phase = (phase + 1) % ARRAY_SIZE(quadrature);
+        gpio_emul_input_set(gpio_dev, ENCODER_A_LINE_A, quadrature[phase][0]);
+        gpio_emul_input_set(gpio_dev, ENCODER_A_LINE_A + 1, quadrature[phase][1]);
+        gpio_emul_input_set(gpio_dev, ENCODER_B_LINE_A, quadrature[phase][0]);
+        gpio_emul_input_set(gpio_dev, ENCODER_B_LINE_A + 1, quadrature[phase][1]);
+    }
+}
+
+static K_TIMER_DEFINE(wheel_timer, wheel_timer_handler, NULL);
+
+static void adv_work_handler(struct k_work *work)
+{
+    int err = bt_le_adv_start(BT_LE_ADV_CONN_NAME, ad, ARRAY_SIZE(ad), sd, ARRAY_SIZE(sd));
+
+    if (err)
+    {
+        FAIL("Advertising failed to start (%d)\n", err);
+    }
+}
+
+static K_WORK_DEFINE(adv_work, adv_work_handler);
+
+static bool app_event_handler(const struct app_event_header *aeh)
+{
+    if (is_module_state_event(aeh))
+    {
+        const struct module_state_event *event = cast_module_state_event(aeh);
+
+        /* CAF enables Bluetooth on startup and reports when it is done. */
+        if (check_state(event, MODULE_ID(ble_state), MODULE_STATE_READY))
+        {
+            k_work_submit(&adv_work);
+        }
+        return false;
+    }
+
+    if (is_ble_peer_event(aeh))
+    {
+        const struct ble_peer_event *event = cast_ble_peer_event(aeh);
+
+        if (event->state == PEER_STATE_CONNECTED)
+        {
+            PASS("Central connected\n");
+        }
+        return false;
+    }
+
+    /* Event not handled but subscribed. */
+    __ASSERT_NO_MSG(false);
+    return false;
+}
+
+APP_EVENT_LISTENER(MODULE, app_event_handler);
+APP_EVENT_SUBSCRIBE(MODULE, module_state_event);
+APP_EVENT_SUBSCRIBE(MODULE, ble_peer_event);
+
+static void test_peripheral_init(void)
+{
+    bst_result = In_progress;
+}
+
+static void test_peripheral_main(void)
+{
+    if (!device_is_ready(gpio_dev))
+    {
+        FAIL("GPIO emulator not ready\n");
+        return;
+    }
+
+    if (app_event_manager_init())
+    {
+        FAIL("Application Event Manager not initialized\n");
+        return;
+    }
+    module_set_state(MODULE_STATE_READY);
+
+    k_timer_start(&wheel_timer, K_MSEC(1), K_MSEC(1));
+}
+
+static const struct bst_test_instance test_def[] = {
+    {
+        .test_id = "peripheral",
+        .test_descr = "Streams the ticks of two emulated encoders",
+        .test_post_init_f = test_peripheral_init,
+        .test_main_f = test_peripheral_main,
+    },
+    BSTEST_END_MARKER
+};
+
+struct bst_test_list *test_peripheral_install(struct bst_test_list *tests)
+{
+    return bst_add_tests(tests, test_def);
+}
+
+bst_test_install_t test_installers[] = {test_peripheral_install, NULL};
+
+void main(void)
+{
+    bst_main();
+}
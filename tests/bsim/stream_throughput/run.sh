@@ -0,0 +1,43 @@
+#!/usr/bin/env bash
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+# Throughput benchmark of the raw encoder stream in BabbleSim.
+#
+# Builds the device image (stream module, QDEC driver, emulated encoders) and
+# a central that subscribes and measures the sample rate, throughput and
+# losses, then runs both on the simulated 2.4 GHz phy. Requires ZEPHYR_BASE,
+# BSIM_OUT_PATH and BSIM_COMPONENTS_PATH as for the Zephyr BabbleSim tests.
+#
+# Usage: run.sh [simulated seconds]
+
+set -eu
+
+: "${BSIM_OUT_PATH:?Set BSIM_OUT_PATH to the BabbleSim output folder}"
+: "${BSIM_COMPONENTS_PATH:?Set BSIM_COMPONENTS_PATH to the BabbleSim components folder}"
+
+here=$(cd "$(dirname "$0")" && pwd)
+sim_id=stream_throughput
+sim_length_us=$((${1:-30} * 1000000))
+bin_dir=${BSIM_OUT_PATH}/bin
+
+for image in peripheral central; do
+    west build -b nrf52_bsim -d "${here}/build/${image}" "${here}/${image}" --pristine auto
+    cp "${here}/build/${image}/zephyr/zephyr.exe" "${bin_dir}/bs_nrf52_bsim_${sim_id}_${image}"
+done
+
+cd "${bin_dir}"
+./bs_nrf52_bsim_${sim_id}_peripheral -s=${sim_id} -d=0 -testid=peripheral -RealEncryption=0 &
+pids="$!"
+./bs_nrf52_bsim_${sim_id}_central -s=${sim_id} -d=1 -testid=central -RealEncryption=0 &
+pids="${pids} $!"
+./bs_2G4_phy_v1 -s=${sim_id} -D=2 -sim_length=${sim_length_us} &
+pids="${pids} $!"
+
+status=0
+for pid in ${pids}; do
+    wait "${pid}" || status=1
+done
+exit ${status}
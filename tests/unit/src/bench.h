@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <zephyr/kernel.h>
+#include <ztest.h>
+
+/* Calls per measurement, long enough to average out the cycle counter
+ * resolution. On native_posix the counter only advances with simulated
+ * time, so the numbers are only meaningful on a real or emulated core.
+ */
+#define BENCH_RUNS 1000
+
+/* Keeps the compiler from dropping the benchmarked calls. */
+extern volatile float bench_sink;
+
+/* Evaluates expr BENCH_RUNS times and gives the mean cycles per run. The
+ * variable bench_i counts the runs and may be used in expr.
+ */
+#define BENCH_CYCLES(expr)							\
+	({									\
+		uint32_t bench_start = k_cycle_get_32();			\
+										\
+		for (int bench_i = 0; bench_i < BENCH_RUNS; bench_i++) {	\
+			bench_sink = (expr);					\
+		}								\
+		(k_cycle_get_32() - bench_start) / BENCH_RUNS;			\
+	})
+
+#define BENCH_REPORT(name, cycles)						\
+	TC_PRINT("%-24s %6u cycles, %u ns\n", name, cycles,			\
+		 (uint32_t)k_cyc_to_ns_floor64(cycles))
+
+#endif /* _BENCH_H_ */
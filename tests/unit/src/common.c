@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <ztest.h>
+
+#include <app_event_manager.h>
+
+#define MODULE main
+#include <caf/events/module_state_event.h>
+
+#include "common.h"
+
+static bool started;
+
+void common_start(void)
+{
+	if (started)
+	{
+		return;
+	}
+	started = true;
+
+	zassert_ok(app_event_manager_init(), "Application Event Manager not initialized");
+	module_set_state(MODULE_STATE_READY);
+	if (IS_ENABLED(CONFIG_ENCODER_MODULE))
+	{
+		common_submit_app_event(APP_EVT_ACTIVITY_DETECTION_ENABLE);
+	}
+	k_sleep(K_MSEC(100));
+}
+
+void common_submit_app_event(enum app_module_event_type type)
+{
+	struct app_module_event *event = new_app_module_event();
+
+	event->type = type;
+	APP_EVENT_SUBMIT(event);
+}
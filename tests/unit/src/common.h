@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _COMMON_H_
+#define _COMMON_H_
+
+/**@file
+ *@brief Fixture shared by the suites that use application events.
+ */
+
+#include "events/app_module_event.h"
+
+/**
+ * @brief Initializes the Application Event Manager and reports the main
+ *        module ready, which starts the modules under test. Only the first
+ *        call has any effect.
+ *
+ * Encoder sampling is paused right away, so that the other suites only see
+ * their own encoder events. The encoder suite resumes it for its tests.
+ */
+void common_start(void);
+
+/** @brief Submits an application module event without data. */
+void common_submit_app_event(enum app_module_event_type type);
+
+#endif /* _COMMON_H_ */
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <drivers/spi.h>
+
+#include "fake_spi.h"
+
+#define DT_DRV_COMPAT test_fake_spi
+
+static struct {
+	uint32_t transactions;
+	bool hold;
+	struct k_poll_signal *pending;
+	const uint8_t *in_flight_buf;
+	uint8_t last_frame[FAKE_SPI_FRAME_MAX_SIZE];
+} fake;
+
+static void record(const struct spi_buf_set *tx_bufs)
+{
+	const struct spi_buf *buf = &tx_bufs->buffers[0];
+
+	fake.transactions++;
+	memcpy(fake.last_frame, buf->buf, MIN(buf->len, sizeof(fake.last_frame)));
+	fake.in_flight_buf = buf->buf;
+}
+
+static int fake_transceive(const struct device *dev, const struct spi_config *config,
+			   const struct spi_buf_set *tx_bufs, const struct spi_buf_set *rx_bufs)
+{
+	record(tx_bufs);
+	fake.in_flight_buf = NULL;
+	return 0;
+}
+
+static int fake_transceive_async(const struct device *dev, const struct spi_config *config,
+				 const struct spi_buf_set *tx_bufs,
+				 const struct spi_buf_set *rx_bufs,
+				 struct k_poll_signal *async)
+{
+	if (fake.pending)
+	{
+		return -EBUSY;
+	}
+
+	record(tx_bufs);
+	fake.pending = async;
+	if (!fake.hold)
+	{
+		fake_spi_complete();
+	}
+	return 0;
+}
+
+static int fake_release(const struct device *dev, const struct spi_config *config)
+{
+	return 0;
+}
+
+void fake_spi_reset(void)
+{
+	fake_spi_complete();
+	fake.transactions = 0;
+}
+
+void fake_spi_hold(bool hold)
+{
+	fake.hold = hold;
+}
+
+void fake_spi_complete(void)
+{
+	struct k_poll_signal *async = fake.pending;
+
+	fake.pending = NULL;
+	fake.in_flight_buf = NULL;
+	if (async)
+	{
+		k_poll_signal_raise(async, 0);
+	}
+}
+
+uint32_t fake_spi_transactions(void)
+{
+	return fake.transactions;
+}
+
+const uint8_t *fake_spi_last_frame(void)
+{
+	return fake.last_frame;
+}
+
+const uint8_t *fake_spi_in_flight_buf(void)
+{
+	return fake.in_flight_buf;
+}
+
+static const struct spi_driver_api fake_spi_api = {
+	.transceive = fake_transceive,
+	.transceive_async = fake_transceive_async,
+	.release = fake_release,
+};
+
+static int fake_spi_init(const struct device *dev)
+{
+	return 0;
+}
+
+DEVICE_DT_INST_DEFINE(0, fake_spi_init, NULL, NULL, NULL, POST_KERNEL,
+		      CONFIG_SPI_INIT_PRIORITY, &fake_spi_api);
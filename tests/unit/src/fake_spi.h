@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _FAKE_SPI_H_
+#define _FAKE_SPI_H_
+
+/**@file
+ *@brief SPI controller double that counts transfers.
+ */
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+
+/** @brief Size of the copy kept of the last transfer. */
+#define FAKE_SPI_FRAME_MAX_SIZE 16
+
+/** @brief Clears the transfer count and completes any held transfer. */
+void fake_spi_reset(void);
+
+/** @brief Keeps asynchronous transfers in flight until fake_spi_complete(). */
+void fake_spi_hold(bool hold);
+
+/** @brief Completes the asynchronous transfer in flight, if any. */
+void fake_spi_complete(void);
+
+/** @brief Number of transfers started since the last reset. */
+uint32_t fake_spi_transactions(void);
+
+/** @brief Copy of the data of the last transfer, taken when it started. */
+const uint8_t *fake_spi_last_frame(void);
+
+/** @brief Buffer the transfer in flight reads from, NULL if none. */
+const uint8_t *fake_spi_in_flight_buf(void);
+
+#endif /* _FAKE_SPI_H_ */
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <ztest.h>
+#include <math.h>
+
+#include "axis_filter.h"
+#include "bench.h"
+
+#define SAMPLE_PERIOD_S	0.01f
+#define TOLERANCE	1e-5f
+
+volatile float bench_sink;
+
+static struct axis_filter_coeffs coeffs;
+static struct axis_filter_state state;
+
+static void configure(uint16_t lowpass_cutoff_dhz, uint16_t slew_rate_permille,
+		      uint16_t deadzone_permille, uint16_t knee_permille)
+{
+	struct axis_filter_config config = {
+		.lowpass_cutoff_dhz = lowpass_cutoff_dhz,
+		.slew_rate_permille = slew_rate_permille,
+		.deadzone_permille = deadzone_permille,
+		.knee_permille = knee_permille,
+	};
+
+	zassert_true(axis_filter_config_valid(&config), NULL);
+	axis_filter_coeffs_compute(&config, SAMPLE_PERIOD_S, &coeffs);
+	axis_filter_reset(&state);
+}
+
+static void axis_filter_before(void *fixture)
+{
+	configure(0, 0, 0, 0);
+}
+
+ZTEST(axis_filter, test_config_valid)
+{
+	struct axis_filter_config config = { .deadzone_permille = 1000 };
+
+	zassert_false(axis_filter_config_valid(&config), "Deadzone over full scale");
+	config.deadzone_permille = 0;
+	config.knee_permille = 1001;
+	zassert_false(axis_filter_config_valid(&config), "Knee over full scale");
+}
+
+/* With every stage disabled the chain passes the input through. */
+ZTEST(axis_filter, test_pass_through)
+{
+	const float inputs[] = { 0.0f, 0.5f, -0.25f, 1.0f, -1.0f, 0.001f };
+
+	for (size_t i = 0; i < ARRAY_SIZE(inputs); i++)
+	{
+		zassert_within(axis_filter_run(&coeffs, &state, inputs[i]), inputs[i], TOLERANCE,
+			       "Input %d changed", i);
+	}
+}
+
+/* The low-pass has unity gain at DC, and a Butterworth step response
+ * overshoots by less than 5 %.
+ */
+ZTEST(axis_filter, test_lowpass_step)
+{
+	float y, peak = 0.0f;
+
+	configure(50, 0, 0, 0);
+
+	y = axis_filter_run(&coeffs, &state, 1.0f);
+	zassert_true(y < 0.5f, "5 Hz low-pass passed a step at once (%f)", (double)y);
+	for (int i = 0; i < 200; i++)
+	{
+		y = axis_filter_run(&coeffs, &state, 1.0f);
+		peak = MAX(peak, y);
+	}
+	zassert_within(y, 1.0f, 1e-3f, "DC gain %f", (double)y);
+	zassert_true(peak < 1.05f, "Overshoot to %f", (double)peak);
+}
+
+/* A cutoff at or above the Nyquist frequency disables the low-pass. */
+ZTEST(axis_filter, test_lowpass_above_nyquist)
+{
+	configure(500, 0, 0, 0);
+	zassert_within(axis_filter_run(&coeffs, &state, 1.0f), 1.0f, TOLERANCE, NULL);
+}
+
+ZTEST(axis_filter, test_slew_rate)
+{
+	float y = 0.0f;
+
+	/* Full scale per second is 0.01 per sample. */
+	configure(0, 1000, 0, 0);
+	for (int i = 1; i <= 10; i++)
+	{
+		y = axis_filter_run(&coeffs, &state, 1.0f);
+		zassert_within(y, 0.01f * i, TOLERANCE, "Sample %d is %f", i, (double)y);
+	}
+	for (int i = 1; i <= 10; i++)
+	{
+		y = axis_filter_run(&coeffs, &state, -1.0f);
+	}
+	zassert_within(y, 0.0f, TOLERANCE, "Slew rate not symmetric (%f)", (double)y);
+}
+
+/* The deadzone is removed and the rest rescaled to full scale. */
+ZTEST(axis_filter, test_deadzone)
+{
+	configure(0, 0, 100, 0);
+	zassert_within(axis_filter_run(&coeffs, &state, 0.05f), 0.0f, TOLERANCE, NULL);
+	zassert_within(axis_filter_run(&coeffs, &state, -0.1f), 0.0f, TOLERANCE, NULL);
+	zassert_within(axis_filter_run(&coeffs, &state, 0.55f), 0.5f, TOLERANCE, NULL);
+	zassert_within(axis_filter_run(&coeffs, &state, -1.0f), -1.0f, TOLERANCE, NULL);
+}
+
+/* Quadratic below the knee, linear above, and continuous at the knee. */
+ZTEST(axis_filter, test_slow_start)
+{
+	configure(0, 0, 0, 500);
+	zassert_within(axis_filter_run(&coeffs, &state, 0.25f), 0.125f, TOLERANCE, NULL);
+	zassert_within(axis_filter_run(&coeffs, &state, -0.25f), -0.125f, TOLERANCE, NULL);
+	zassert_within(axis_filter_run(&coeffs, &state, 0.5f), 0.5f, TOLERANCE, NULL);
+	zassert_within(axis_filter_run(&coeffs, &state, 0.75f), 0.75f, TOLERANCE, NULL);
+}
+
+ZTEST(axis_filter, test_reset)
+{
+	configure(50, 1000, 0, 0);
+	for (int i = 0; i < 20; i++)
+	{
+		axis_filter_run(&coeffs, &state, 1.0f);
+	}
+	axis_filter_reset(&state);
+	zassert_within(axis_filter_run(&coeffs, &state, 0.0f), 0.0f, TOLERANCE, NULL);
+}
+
+/* Cycles per sample with each stage enabled alone, and with the whole
+ * chain. The chain has no branches on the configuration, so differences
+ * come from the arithmetic alone, e.g. soft-float on zero coefficients.
+ */
+ZTEST(axis_filter, test_benchmark_stages)
+{
+	static const struct {
+		const char *name;
+		struct axis_filter_config config;
+	} stages[] = {
+		{ "pass-through", { 0 } },
+		{ "low-pass", { .lowpass_cutoff_dhz = 50 } },
+		{ "slew rate limiter", { .slew_rate_permille = 4000 } },
+		{ "deadzone", { .deadzone_permille = 50 } },
+		{ "slow start", { .knee_permille = 300 } },
+		{ "full chain", { 50, 4000, 50, 300 } },
+	};
+	uint32_t cycles;
+
+	for (size_t i = 0; i < ARRAY_SIZE(stages); i++)
+	{
+		axis_filter_coeffs_compute(&stages[i].config, SAMPLE_PERIOD_S, &coeffs);
+		axis_filter_reset(&state);
+		cycles = BENCH_CYCLES(axis_filter_run(&coeffs, &state,
+						      (bench_i & 0x40) ? 0.8f : -0.3f));
+		BENCH_REPORT(stages[i].name, cycles);
+	}
+
+	cycles = BENCH_CYCLES((axis_filter_coeffs_compute(&stages[5].config, SAMPLE_PERIOD_S,
+							  &coeffs),
+			       coeffs.b0));
+	BENCH_REPORT("coefficients", cycles);
+
+	/* The filter still works after the runs. */
+	axis_filter_reset(&state);
+	zassert_within(axis_filter_run(&coeffs, &state, 0.0f), 0.0f, TOLERANCE, NULL);
+}
+
+ZTEST_SUITE(axis_filter, NULL, NULL, axis_filter_before, NULL, NULL);
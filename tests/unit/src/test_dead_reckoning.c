@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <ztest.h>
+#include <math.h>
+
+#include "dead_reckoning.h"
+#include "bench.h"
+
+#define PI_F		3.14159265358979323846f
+#define TOLERANCE	1e-4f
+
+static const struct dead_reckoning_geometry geometry = {
+	.m_per_tick = 0.001f,
+	.half_track = 0.3f,
+};
+
+static struct dead_reckoning dr;
+
+static void dead_reckoning_before(void *fixture)
+{
+	dead_reckoning_reset(&dr);
+}
+
+/* Equal ticks on both wheels drive straight ahead along the y-axis. */
+ZTEST(dead_reckoning, test_straight)
+{
+	for (int i = 0; i < 10; i++)
+	{
+		dead_reckoning_update(&dr, &geometry, 100, 100);
+	}
+	zassert_within(dr.x, 0.0f, TOLERANCE, NULL);
+	zassert_within(dr.y, 2.0f, TOLERANCE, "y is %f", (double)dr.y);
+	zassert_within(dead_reckoning_distance(&dr, &geometry), 2.0f, TOLERANCE, NULL);
+	zassert_within(dead_reckoning_heading(&dr), 0.0f, TOLERANCE, NULL);
+
+	for (int i = 0; i < 10; i++)
+	{
+		dead_reckoning_update(&dr, &geometry, -100, -100);
+	}
+	zassert_within(dr.y, 0.0f, TOLERANCE, "Reversing did not return, y is %f", (double)dr.y);
+	zassert_within(dead_reckoning_distance(&dr, &geometry), 0.0f, TOLERANCE, NULL);
+}
+
+/* Opposite ticks turn on the spot, clockwise when the left-hand wheel
+ * moves forwards.
+ */
+ZTEST(dead_reckoning, test_turn_in_place)
+{
+	/* The heading changes by the travel of b minus a over the half track. */
+	int32_t ticks = (int32_t)(geometry.half_track * PI_F / 4.0f / geometry.m_per_tick + 0.5f);
+
+	dead_reckoning_update(&dr, &geometry, -ticks, ticks);
+	zassert_within(dead_reckoning_heading(&dr), PI_F / 2.0f, 1e-2f, "Heading %f",
+		       (double)dead_reckoning_heading(&dr));
+	zassert_within(dead_reckoning_distance(&dr, &geometry), 0.0f, TOLERANCE, NULL);
+	zassert_within(dr.x, 0.0f, TOLERANCE, NULL);
+	zassert_within(dr.y, 0.0f, TOLERANCE, NULL);
+
+	/* Driving forwards now moves along the x-axis. */
+	dead_reckoning_update(&dr, &geometry, 500, 500);
+	zassert_within(dr.x, 1.0f, 1e-2f, "x is %f", (double)dr.x);
+	zassert_within(dr.y, 0.0f, 1e-2f, "y is %f", (double)dr.y);
+}
+
+/* The heading is reported in [-pi, pi) however far the wheels turned. */
+ZTEST(dead_reckoning, test_heading_wraps)
+{
+	float heading;
+
+	/* About five turns, in steps of a little less than a quarter turn. */
+	for (int i = 0; i < 20; i++)
+	{
+		dead_reckoning_update(&dr, &geometry, -230, 230);
+		heading = dead_reckoning_heading(&dr);
+		zassert_true(heading >= -PI_F && heading < PI_F, "Heading %f", (double)heading);
+		zassert_within(sinf(heading), sinf(dr.heading), TOLERANCE, NULL);
+		zassert_within(cosf(heading), cosf(dr.heading), TOLERANCE, NULL);
+	}
+}
+
+/* A change of geometry keeps the distance and heading, and only applies
+ * to the ticks that follow.
+ */
+ZTEST(dead_reckoning, test_rebase)
+{
+	const struct dead_reckoning_geometry larger = {
+		.m_per_tick = 2.0f * geometry.m_per_tick,
+		.half_track = geometry.half_track,
+	};
+	float heading;
+
+	dead_reckoning_update(&dr, &geometry, 1000, 1200);
+	heading = dead_reckoning_heading(&dr);
+
+	dead_reckoning_rebase(&dr, &geometry);
+	zassert_within(dead_reckoning_distance(&dr, &larger), 2.2f, TOLERANCE, NULL);
+	zassert_within(dead_reckoning_heading(&dr), heading, TOLERANCE, NULL);
+
+	dead_reckoning_update(&dr, &larger, 100, 100);
+	zassert_within(dead_reckoning_distance(&dr, &larger), 2.6f, TOLERANCE, NULL);
+	zassert_within(dead_reckoning_heading(&dr), heading, TOLERANCE, NULL);
+
+	/* A second rebase in a row has nothing to fold. */
+	dead_reckoning_rebase(&dr, &larger);
+	dead_reckoning_rebase(&dr, &geometry);
+	zassert_within(dead_reckoning_distance(&dr, &larger), 2.6f, TOLERANCE, NULL);
+}
+
+ZTEST(dead_reckoning, test_reset)
+{
+	dead_reckoning_update(&dr, &geometry, 1000, 1200);
+	dead_reckoning_rebase(&dr, &geometry);
+	dead_reckoning_reset(&dr);
+	zassert_within(dead_reckoning_distance(&dr, &geometry), 0.0f, TOLERANCE, NULL);
+	zassert_within(dead_reckoning_heading(&dr), 0.0f, TOLERANCE, NULL);
+	zassert_within(dr.x, 0.0f, TOLERANCE, NULL);
+	zassert_within(dr.y, 0.0f, TOLERANCE, NULL);
+}
+
+ZTEST(dead_reckoning, test_benchmark)
+{
+	uint32_t cycles = BENCH_CYCLES((dead_reckoning_update(&dr, &geometry, 3, (bench_i & 1) + 2),
+					dr.heading));
+
+	BENCH_REPORT("dead reckoning", cycles);
+}
+
+ZTEST_SUITE(dead_reckoning, NULL, NULL, dead_reckoning_before, NULL, NULL);
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <ztest.h>
+
+#include <app_event_manager.h>
+#include "events/encoder_module_event.h"
+
+#include "common.h"
+
+#define PERIOD_US	(CONFIG_ENCODER_DELTA_TIME_MSEC * USEC_PER_MSEC)
+/* Load injected on the system work queue, ahead of the sampling work. */
+#define LOAD_PERIODS	5
+#define LOAD_US		(LOAD_PERIODS * PERIOD_US)
+
+static atomic_t data_events;
+static atomic_t deadline_events;
+static atomic_t last_missed;
+static atomic_t last_worst_us;
+
+static void load_work_handler(struct k_work *work)
+{
+	k_busy_wait(LOAD_US);
+}
+
+static K_WORK_DEFINE(load_work, load_work_handler);
+
+static bool app_event_handler(const struct app_event_header *aeh)
+{
+	if (is_encoder_module_event(aeh))
+	{
+		const struct encoder_module_event *event = cast_encoder_module_event(aeh);
+
+		if (event->type == ENCODER_EVT_DATA_READY)
+		{
+			atomic_inc(&data_events);
+		}
+		else if (event->type == ENCODER_EVT_DEADLINE_MISSED)
+		{
+			atomic_set(&last_missed, event->data.deadline.missed);
+			atomic_set(&last_worst_us, event->data.deadline.worst_lateness_us);
+			atomic_inc(&deadline_events);
+		}
+		return false;
+	}
+
+	return false;
+}
+
+APP_EVENT_LISTENER(encoder_deadline_listener, app_event_handler);
+APP_EVENT_SUBSCRIBE(encoder_deadline_listener, encoder_module_event);
+
+static void *encoder_deadline_setup(void)
+{
+	common_start();
+	return NULL;
+}
+
+static void encoder_deadline_before(void *fixture)
+{
+	common_submit_app_event(APP_EVT_ACTIVITY_DETECTION_DISABLE);
+	k_sleep(K_MSEC(100));
+}
+
+static void encoder_deadline_after(void *fixture)
+{
+	/* Leaves the encoder events to the other suites. */
+	common_submit_app_event(APP_EVT_ACTIVITY_DETECTION_ENABLE);
+}
+
+/* Sampling on an idle system misses nothing. */
+ZTEST(encoder_deadline, test_no_load_no_misses)
+{
+	atomic_val_t deadlines = atomic_get(&deadline_events);
+	atomic_val_t samples = atomic_get(&data_events);
+
+	k_sleep(K_MSEC(500));
+
+	zassert_equal(atomic_get(&deadline_events), deadlines, "Deadline missed without load");
+	zassert_true(atomic_get(&data_events) - samples >= 45, "Only %d samples in 500 ms",
+		     (int)(atomic_get(&data_events) - samples));
+}
+
+/* Work that holds the system work queue for several periods delays the
+ * sampling work. The merged periods are counted and the lateness reported.
+ */
+ZTEST(encoder_deadline, test_load_reports_misses)
+{
+	atomic_val_t deadlines = atomic_get(&deadline_events);
+	atomic_val_t missed = atomic_get(&last_missed);
+	atomic_val_t samples;
+
+	k_work_submit(&load_work);
+	k_sleep(K_MSEC(200));
+
+	zassert_equal(atomic_get(&deadline_events), deadlines + 1, "No single warning for the load");
+	zassert_true(atomic_get(&last_missed) - missed >= LOAD_PERIODS - 1,
+		     "%d deadlines missed", (int)(atomic_get(&last_missed) - missed));
+	zassert_true(atomic_get(&last_worst_us) >= LOAD_US - PERIOD_US,
+		     "Worst lateness %d us", (int)atomic_get(&last_worst_us));
+
+	/* Sampling goes on at the normal rate afterwards. */
+	samples = atomic_get(&data_events);
+	k_sleep(K_MSEC(100));
+	zassert_true(atomic_get(&data_events) - samples >= 9, NULL);
+}
+
+/* While the wheels are still, sampling pauses and the deadline monitor
+ * counts nothing. Once resumed, sampling goes on at the normal rate and the
+ * pause is not reported as missed deadlines.
+ */
+ZTEST(encoder_deadline, test_pause_stops_counters)
+{
+	atomic_val_t deadlines = atomic_get(&deadline_events);
+	atomic_val_t samples;
+
+	common_submit_app_event(APP_EVT_ACTIVITY_DETECTION_ENABLE);
+	/* The samples taken before the pause are submitted with it. */
+	k_sleep(K_MSEC(2 * CONFIG_ENCODER_DELTA_TIME_MSEC));
+	samples = atomic_get(&data_events);
+
+	k_sleep(K_MSEC(500));
+	zassert_equal(atomic_get(&data_events), samples, "%d samples while paused",
+		      (int)(atomic_get(&data_events) - samples));
+
+	common_submit_app_event(APP_EVT_ACTIVITY_DETECTION_DISABLE);
+	k_sleep(K_MSEC(500));
+	zassert_true(atomic_get(&data_events) - samples >= 45, "Only %d samples in 500 ms",
+		     (int)(atomic_get(&data_events) - samples));
+	zassert_equal(atomic_get(&deadline_events), deadlines, "Pause reported as missed deadlines");
+}
+
+ZTEST_SUITE(encoder_deadline, NULL, encoder_deadline_setup, encoder_deadline_before,
+	    encoder_deadline_after, NULL);
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <ztest.h>
+
+#include <app_event_manager.h>
+#include "events/encoder_module_event.h"
+
+#include "bench.h"
+#include "common.h"
+
+#define BATCH_SIZE_MAX	32
+/* Samples dispatched for every batch size. */
+#define BENCH_SAMPLES	(BATCH_SIZE_MAX * BENCH_RUNS)
+
+/* Stands in for a batched encoder event of any size up to BATCH_SIZE_MAX,
+ * whatever CONFIG_ENCODER_BATCH_SIZE is. The samples are referenced rather
+ * than copied, the dispatch cost does not depend on the size of the event.
+ * Small enough for the general event pool, which works like the encoder
+ * blocks.
+ */
+struct bench_batch_event {
+	struct app_event_header header;
+	const struct encoder_sample *samples;
+	uint8_t sample_count;
+};
+
+APP_EVENT_TYPE_DECLARE(bench_batch_event);
+APP_EVENT_TYPE_DEFINE(bench_batch_event, NULL, NULL, APP_EVENT_FLAGS_CREATE());
+
+static struct encoder_sample samples[BATCH_SIZE_MAX];
+static uint32_t received_samples;
+
+static bool app_event_handler(const struct app_event_header *aeh)
+{
+	if (is_bench_batch_event(aeh))
+	{
+		const struct bench_batch_event *event = cast_bench_batch_event(aeh);
+
+		/* Every sample is touched once, like the HID module does. */
+		for (size_t i = 0; i < event->sample_count; i++)
+		{
+			bench_sink = event->samples[i].rot_speed_a + event->samples[i].rot_speed_b;
+		}
+		received_samples += event->sample_count;
+		return false;
+	}
+
+	return false;
+}
+
+APP_EVENT_LISTENER(event_dispatch_listener, app_event_handler);
+APP_EVENT_SUBSCRIBE(event_dispatch_listener, bench_batch_event);
+
+static void *event_dispatch_setup(void)
+{
+	common_start();
+	for (size_t i = 0; i < ARRAY_SIZE(samples); i++)
+	{
+		samples[i].rot_speed_a = i;
+		samples[i].rot_speed_b = -(float)i;
+	}
+	return NULL;
+}
+
+/**
+ * @brief Dispatches BENCH_SAMPLES samples in events of a batch size, each
+ *        processed as it is submitted
+ *
+ * @return Mean cycles per sample, from allocation to the listener
+ */
+static uint32_t dispatch_cycles_per_sample(uint8_t batch_size)
+{
+	uint32_t events = BENCH_SAMPLES / batch_size;
+	uint32_t start;
+	uint32_t cycles;
+
+	received_samples = 0;
+	start = k_cycle_get_32();
+	for (uint32_t i = 0; i < events; i++)
+	{
+		struct bench_batch_event *event = new_bench_batch_event();
+
+		event->samples = samples;
+		event->sample_count = batch_size;
+		APP_EVENT_SUBMIT(event);
+	}
+	cycles = k_cycle_get_32() - start;
+
+	zassert_equal(received_samples, events * batch_size, "Events still queued");
+	return cycles / (events * batch_size);
+}
+
+/* Prints the dispatch cost per sample for batch sizes 1 through 32. The
+ * cycle counts only mean something on a core, on native_posix they stay at
+ * zero.
+ */
+ZTEST(event_dispatch, test_cost_per_sample)
+{
+	uint32_t cycles[BATCH_SIZE_MAX + 1];
+
+	TC_PRINT("Batch  cycles/sample  ns/sample\n");
+	for (uint8_t batch_size = 1; batch_size <= BATCH_SIZE_MAX; batch_size++)
+	{
+		cycles[batch_size] = dispatch_cycles_per_sample(batch_size);
+		TC_PRINT("%5u  %13u  %9u\n", batch_size, cycles[batch_size],
+			 (uint32_t)k_cyc_to_ns_floor64(cycles[batch_size]));
+	}
+
+	if (cycles[1] > 0)
+	{
+		zassert_true(cycles[BATCH_SIZE_MAX] < cycles[1],
+			     "Batches of %d cost %u cycles per sample, single samples %u",
+			     BATCH_SIZE_MAX, cycles[BATCH_SIZE_MAX], cycles[1]);
+	}
+}
+
+ZTEST_SUITE(event_dispatch, NULL, event_dispatch_setup, NULL, NULL, NULL);
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/sys_heap.h>
+#include <ztest.h>
+
+#include <app_event_manager.h>
+#include "events/event_pool.h"
+#include "events/encoder_module_event.h"
+
+#include "common.h"
+
+/* An hour of sampling at 10 ms, one sample per event. */
+#define LONG_RUN_EVENTS		360000
+
+extern struct k_heap _system_heap;
+
+static atomic_t received;
+
+static bool app_event_handler(const struct app_event_header *aeh)
+{
+	if (is_encoder_module_event(aeh))
+	{
+		atomic_inc(&received);
+		return false;
+	}
+
+	return false;
+}
+
+APP_EVENT_LISTENER(event_pool_listener, app_event_handler);
+APP_EVENT_SUBSCRIBE(event_pool_listener, encoder_module_event);
+
+static size_t heap_max_allocated(void)
+{
+	struct sys_memory_stats stats;
+
+	zassert_ok(sys_heap_runtime_stats_get(&_system_heap.heap, &stats), NULL);
+	return stats.max_allocated_bytes;
+}
+
+/* Submits an encoder event the way the encoder module does. */
+static bool submit_encoder_event(void)
+{
+	struct encoder_module_event *event = event_pool_new_encoder_event();
+
+	if (!event)
+	{
+		return false;
+	}
+	event->type = ENCODER_EVT_DATA_READY;
+	event->sample_count = ENCODER_BATCH_SIZE;
+	APP_EVENT_SUBMIT(event);
+	return true;
+}
+
+static void *event_pool_setup(void)
+{
+	common_start();
+	return NULL;
+}
+
+static void event_pool_before(void *fixture)
+{
+	/* Let the system work queue free the events of the previous test. */
+	k_sleep(K_MSEC(10));
+	atomic_clear(&received);
+}
+
+/* A long run of encoder events never touches the heap. */
+ZTEST(event_pool, test_long_run_heap_high_water_mark)
+{
+	size_t heap_max = heap_max_allocated();
+	struct event_pool_stats before;
+	struct event_pool_stats after;
+
+	event_pool_stats_get(&before);
+	for (uint32_t i = 0; i < LONG_RUN_EVENTS; i++)
+	{
+		zassert_true(submit_encoder_event(), "No free encoder event after %u", i);
+	}
+	k_sleep(K_MSEC(10));
+
+	zassert_equal(atomic_get(&received), LONG_RUN_EVENTS, NULL);
+	zassert_equal(heap_max_allocated(), heap_max, "Heap high-water mark grew from %u to %u",
+		      heap_max, heap_max_allocated());
+
+	event_pool_stats_get(&after);
+	zassert_equal(after.encoder_dropped, before.encoder_dropped, NULL);
+}
+
+/* When the consumers fall behind, encoder events are dropped instead of
+ * being taken from the heap.
+ */
+ZTEST(event_pool, test_exhausted_drops_without_heap)
+{
+	size_t heap_max = heap_max_allocated();
+	struct event_pool_stats before;
+	struct event_pool_stats after;
+	uint32_t submitted = 0;
+
+	event_pool_stats_get(&before);
+
+	/* Keeps the system work queue from processing the events. */
+	k_sched_lock();
+	for (int i = 0; i < 2 * CONFIG_EVENT_POOL_ENCODER_BLOCK_COUNT; i++)
+	{
+		submitted += submit_encoder_event();
+	}
+	k_sched_unlock();
+	k_sleep(K_MSEC(10));
+
+	event_pool_stats_get(&after);
+	zassert_equal(submitted, CONFIG_EVENT_POOL_ENCODER_BLOCK_COUNT, NULL);
+	zassert_equal(after.encoder_dropped - before.encoder_dropped,
+		      CONFIG_EVENT_POOL_ENCODER_BLOCK_COUNT, NULL);
+	zassert_equal(after.encoder_used_max, CONFIG_EVENT_POOL_ENCODER_BLOCK_COUNT, NULL);
+	zassert_equal(atomic_get(&received), submitted, NULL);
+	zassert_equal(heap_max_allocated(), heap_max, NULL);
+
+	/* The blocks are back once the events are processed. */
+	zassert_true(submit_encoder_event(), NULL);
+}
+
+/* Other events of the size of an encoder event neither take the encoder
+ * blocks nor stop the encoder events when the encoder blocks run out.
+ */
+ZTEST(event_pool, test_same_size_event_uses_general_pool)
+{
+	struct event_pool_stats before;
+	struct event_pool_stats after;
+	void *events[CONFIG_EVENT_POOL_ENCODER_BLOCK_COUNT + 1];
+	void *encoder_event;
+
+	event_pool_stats_get(&before);
+	for (int i = 0; i < ARRAY_SIZE(events); i++)
+	{
+		events[i] = app_event_manager_alloc(sizeof(struct encoder_module_event));
+		zassert_not_null(events[i], NULL);
+	}
+
+	encoder_event = event_pool_new_encoder_event();
+	zassert_not_null(encoder_event, "Encoder blocks taken by other events");
+	event_pool_stats_get(&after);
+	zassert_equal(after.encoder_dropped, before.encoder_dropped, NULL);
+
+	app_event_manager_free(encoder_event);
+	for (int i = 0; i < ARRAY_SIZE(events); i++)
+	{
+		app_event_manager_free(events[i]);
+	}
+}
+
+ZTEST_SUITE(event_pool, NULL, event_pool_setup, event_pool_before, NULL, NULL);
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/addr.h>
+#include <ztest.h>
+
+#include "hid_profile.h"
+
+#define PROFILE_COUNT	CONFIG_HID_MODULE_PROFILE_COUNT
+/* RAM budget of one profile, coefficients included. */
+#define PROFILE_MAX_SIZE	512
+
+BUILD_ASSERT(PROFILE_COUNT >= 3, "The recycling test needs three peer profiles");
+
+static bt_addr_le_t peer(uint8_t n)
+{
+	bt_addr_le_t addr = {
+		.type = BT_ADDR_LE_RANDOM,
+		.a.val = {n, 0x00, 0x00, 0x00, 0x00, 0xc0},
+	};
+
+	return addr;
+}
+
+static void hid_profile_before(void *fixture)
+{
+	hid_profile_init();
+}
+
+/* A peer keeps its profile, and every peer gets its own. */
+ZTEST(hid_profile, test_same_peer_same_profile)
+{
+	bt_addr_le_t a = peer(1);
+	bt_addr_le_t b = peer(2);
+	struct hid_profile *profile_a = hid_profile_for_peer(&a);
+	struct hid_profile *profile_b = hid_profile_for_peer(&b);
+
+	zassert_not_equal(profile_a, hid_profile_default(), "Peer got the default profile");
+	zassert_not_equal(profile_a, profile_b, "Two peers share a profile");
+	zassert_equal(hid_profile_for_peer(&a), profile_a, NULL);
+	zassert_equal(hid_profile_for_peer(&b), profile_b, NULL);
+	zassert_false(bt_addr_le_cmp(&profile_a->addr, &a), NULL);
+}
+
+/* A new peer starts from the parameters of the default profile, and
+ * changing its profile leaves the others alone.
+ */
+ZTEST(hid_profile, test_new_peer_copies_default)
+{
+	bt_addr_le_t a = peer(1);
+	bt_addr_le_t b = peer(2);
+	struct hid_tuning_params params;
+	struct hid_tuning_params actual;
+
+	hid_profile_params_get(hid_profile_default(), &params);
+	params.max_speed_mm_per_sec = 1234;
+	zassert_ok(hid_profile_params_set(hid_profile_default(), &params), NULL);
+
+	hid_profile_params_get(hid_profile_for_peer(&a), &actual);
+	zassert_equal(actual.max_speed_mm_per_sec, 1234, NULL);
+
+	params.max_speed_mm_per_sec = 2345;
+	zassert_ok(hid_profile_params_set(hid_profile_for_peer(&a), &params), NULL);
+	hid_profile_params_get(hid_profile_for_peer(&b), &actual);
+	zassert_equal(actual.max_speed_mm_per_sec, 1234, NULL);
+	hid_profile_params_get(hid_profile_default(), &actual);
+	zassert_equal(actual.max_speed_mm_per_sec, 1234, NULL);
+}
+
+/* With every profile taken, a new peer gets the least recently used one. */
+ZTEST(hid_profile, test_lru_recycling)
+{
+	struct hid_profile *profiles[PROFILE_COUNT];
+	bt_addr_le_t addr;
+	struct hid_profile *recycled;
+
+	for (int i = 0; i < PROFILE_COUNT; i++)
+	{
+		addr = peer(i + 1);
+		profiles[i] = hid_profile_for_peer(&addr);
+		hid_profile_release(profiles[i]);
+	}
+
+	/* The first peer reconnects, so the second is now the oldest. */
+	addr = peer(1);
+	zassert_equal(hid_profile_for_peer(&addr), profiles[0], NULL);
+	hid_profile_release(profiles[0]);
+
+	addr = peer(PROFILE_COUNT + 1);
+	recycled = hid_profile_for_peer(&addr);
+	zassert_equal(recycled, profiles[1], "Profile %d recycled",
+		      (int)(recycled - profiles[0]));
+	zassert_false(bt_addr_le_cmp(&recycled->addr, &addr), NULL);
+	hid_profile_release(recycled);
+
+	/* The peer that lost its profile gets the next oldest. */
+	addr = peer(2);
+	zassert_equal(hid_profile_for_peer(&addr), profiles[2], NULL);
+	addr = peer(1);
+	zassert_equal(hid_profile_for_peer(&addr), profiles[0], NULL);
+}
+
+/* The profile of a connected peer is never recycled, however old. With
+ * every profile in use, a new peer gets the default profile.
+ */
+ZTEST(hid_profile, test_connected_profile_kept)
+{
+	struct hid_profile *profiles[PROFILE_COUNT];
+	bt_addr_le_t addr;
+
+	for (int i = 0; i < PROFILE_COUNT; i++)
+	{
+		addr = peer(i + 1);
+		profiles[i] = hid_profile_for_peer(&addr);
+	}
+	/* Only the newest peer disconnects, the first stays the oldest. */
+	hid_profile_release(profiles[PROFILE_COUNT - 1]);
+
+	addr = peer(PROFILE_COUNT + 1);
+	zassert_equal(hid_profile_for_peer(&addr), profiles[PROFILE_COUNT - 1], NULL);
+
+	addr = peer(PROFILE_COUNT + 2);
+	zassert_equal(hid_profile_for_peer(&addr), hid_profile_default(), NULL);
+	hid_profile_release(hid_profile_default());
+
+	for (int i = 0; i < PROFILE_COUNT - 1; i++)
+	{
+		addr = peer(i + 1);
+		zassert_false(bt_addr_le_cmp(&profiles[i]->addr, &addr),
+			      "Profile %d of a connected peer recycled", i);
+	}
+}
+
+/* The profile of a removed peer is reset and taken by the next new peer,
+ * ahead of the least recently used one.
+ */
+ZTEST(hid_profile, test_remove_peer)
+{
+	bt_addr_le_t a = peer(1);
+	bt_addr_le_t b = peer(2);
+	bt_addr_le_t c = peer(3);
+	struct hid_profile *profile_a = hid_profile_for_peer(&a);
+	struct hid_profile *profile_b = hid_profile_for_peer(&b);
+	struct hid_tuning_params params;
+	struct hid_tuning_params defaults;
+
+	hid_profile_params_get(profile_b, &defaults);
+	params = defaults;
+	params.max_speed_mm_per_sec = 2345;
+	zassert_ok(hid_profile_params_set(profile_b, &params), NULL);
+
+	zassert_equal(hid_profile_remove_peer(&b), profile_b, NULL);
+	zassert_false(bt_addr_le_cmp(&profile_b->addr, BT_ADDR_LE_ANY), NULL);
+	hid_profile_params_get(profile_b, &params);
+	zassert_mem_equal(&params, &defaults, sizeof(params), "Parameters not reset");
+	zassert_is_null(hid_profile_remove_peer(&b), NULL);
+
+	zassert_equal(hid_profile_for_peer(&c), profile_b, NULL);
+	zassert_equal(hid_profile_for_peer(&a), profile_a, NULL);
+}
+
+/* Erasing every bond frees every peer profile but keeps the default one. */
+ZTEST(hid_profile, test_remove_all)
+{
+	struct hid_profile *profiles[PROFILE_COUNT];
+	struct hid_tuning_params params;
+	bt_addr_le_t addr;
+
+	hid_profile_params_get(hid_profile_default(), &params);
+	params.max_speed_mm_per_sec = 1234;
+	zassert_ok(hid_profile_params_set(hid_profile_default(), &params), NULL);
+
+	for (int i = 0; i < PROFILE_COUNT; i++)
+	{
+		addr = peer(i + 1);
+		profiles[i] = hid_profile_for_peer(&addr);
+	}
+
+	hid_profile_remove_all();
+
+	for (int i = 0; i < PROFILE_COUNT; i++)
+	{
+		zassert_false(bt_addr_le_cmp(&profiles[i]->addr, BT_ADDR_LE_ANY),
+			      "Profile %d still assigned", i);
+	}
+	hid_profile_params_get(hid_profile_default(), &params);
+	zassert_equal(params.max_speed_mm_per_sec, 1234, "Default profile cleared");
+
+	/* New peers take the free profiles in order. */
+	for (int i = 0; i < PROFILE_COUNT; i++)
+	{
+		addr = peer(PROFILE_COUNT + i + 1);
+		zassert_equal(hid_profile_for_peer(&addr), profiles[i], NULL);
+	}
+}
+
+/* The coefficients follow the parameters once the profiles are updated. */
+ZTEST(hid_profile, test_update_computes_coeffs)
+{
+	bt_addr_le_t a = peer(1);
+	struct hid_profile *profile = hid_profile_for_peer(&a);
+	struct hid_tuning_params params;
+
+	hid_profile_update();
+	hid_profile_params_get(profile, &params);
+	zassert_within(profile->coeffs.max_translational_speed_m_per_sec,
+		       params.max_speed_mm_per_sec / 1000.0f, 1e-6f, NULL);
+
+	params.max_speed_mm_per_sec = 2000;
+	params.cylinder_diameter_mm = 100;
+	zassert_ok(hid_profile_params_set(profile, &params), NULL);
+	hid_profile_update();
+
+	zassert_within(profile->coeffs.max_translational_speed_m_per_sec, 2.0f, 1e-6f, NULL);
+	zassert_within(profile->coeffs.translation_norm, 0.5f, 1e-6f, NULL);
+	zassert_within(profile->coeffs.r_c, 0.05f, 1e-6f, NULL);
+	zassert_not_equal(hid_profile_default()->coeffs.r_c, profile->coeffs.r_c,
+			  "Default profile recomputed from the peer parameters");
+
+	params.max_speed_mm_per_sec = 0;
+	zassert_equal(hid_profile_params_set(profile, &params), -EINVAL, NULL);
+}
+
+/* Every bond costs one profile of RAM, keep an eye on what it grows to. */
+ZTEST(hid_profile, test_memory_cost)
+{
+	size_t size = sizeof(struct hid_profile);
+	size_t total = (1 + PROFILE_COUNT) * size;
+
+	TC_PRINT("Profile %zu B (coefficients %zu B), %d profiles %zu B\n",
+		 size, sizeof(struct hid_coeffs), 1 + PROFILE_COUNT, total);
+
+	zassert_true(size <= PROFILE_MAX_SIZE, "Profile is %zu B, budget %d B",
+		     size, PROFILE_MAX_SIZE);
+}
+
+ZTEST_SUITE(hid_profile, NULL, NULL, hid_profile_before, NULL, NULL);
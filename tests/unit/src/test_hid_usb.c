@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/usb/usb_device.h>
+#include <zephyr/usb/class/usb_hid.h>
+#include <ztest.h>
+
+#include "hid_usb.h"
+
+/* GET_REPORT/SET_REPORT carry the report type in the high byte of wValue. */
+#define REPORT_TYPE_INPUT	0x01
+#define REPORT_TYPE_FEATURE	0x03
+#define FEATURE_ID		5
+
+/* The USB device is never enabled, the class callbacks are called directly.
+ * usb_enable() and usb_hid_register_device() are wrapped at link time, see
+ * CMakeLists.txt.
+ */
+static const struct hid_ops *hid_ops;
+
+void __real_usb_hid_register_device(const struct device *dev, const uint8_t *desc,
+				    size_t size, const struct hid_ops *op);
+
+void __wrap_usb_hid_register_device(const struct device *dev, const uint8_t *desc,
+				    size_t size, const struct hid_ops *op)
+{
+	hid_ops = op;
+	__real_usb_hid_register_device(dev, desc, size, op);
+}
+
+int __wrap_usb_enable(usb_dc_status_callback status_cb)
+{
+	return 0;
+}
+
+static struct {
+	uint8_t report_id;
+	uint8_t data[8];
+	size_t len;
+	int ret;
+	uint32_t calls;
+} feature;
+
+static int feature_get(uint8_t report_id, uint8_t *data, size_t len)
+{
+	feature.report_id = report_id;
+	feature.calls++;
+	if (feature.ret < 0)
+	{
+		return feature.ret;
+	}
+	zassert_true(len >= sizeof(feature.data), "Buffer of %zu B", len);
+	memcpy(data, feature.data, sizeof(feature.data));
+	return sizeof(feature.data);
+}
+
+static int feature_set(uint8_t report_id, const uint8_t *data, size_t len)
+{
+	feature.report_id = report_id;
+	feature.calls++;
+	feature.len = MIN(len, sizeof(feature.data));
+	memcpy(feature.data, data, feature.len);
+	return feature.ret;
+}
+
+static const struct hid_usb_feature_cb feature_cb = {
+	.get = feature_get,
+	.set = feature_set,
+};
+
+static int get_report(uint8_t type, uint8_t report_id, int32_t *len, uint8_t **data)
+{
+	struct usb_setup_packet setup = {
+		.wValue = (type << 8) | report_id,
+	};
+
+	return hid_ops->get_report(NULL, &setup, len, data);
+}
+
+static int set_report(uint8_t type, uint8_t report_id, uint8_t *buf, int32_t len)
+{
+	struct usb_setup_packet setup = {
+		.wValue = (type << 8) | report_id,
+	};
+
+	return hid_ops->set_report(NULL, &setup, &len, &buf);
+}
+
+static void *hid_usb_setup(void)
+{
+	zassert_not_null(hid_ops, "USB HID device not registered");
+	return NULL;
+}
+
+static void hid_usb_before(void *fixture)
+{
+	memset(&feature, 0, sizeof(feature));
+	hid_usb_set_feature_cb(&feature_cb);
+}
+
+/* A feature report is read with its report ID in front. */
+ZTEST(hid_usb, test_get_feature)
+{
+	int32_t len = 0;
+	uint8_t *data = NULL;
+
+	for (int i = 0; i < sizeof(feature.data); i++)
+	{
+		feature.data[i] = i + 1;
+	}
+
+	zassert_ok(get_report(REPORT_TYPE_FEATURE, FEATURE_ID, &len, &data), NULL);
+	zassert_equal(feature.report_id, FEATURE_ID, NULL);
+	zassert_equal(len, 1 + sizeof(feature.data), NULL);
+	zassert_not_null(data, NULL);
+	zassert_equal(data[0], FEATURE_ID, NULL);
+	zassert_mem_equal(&data[1], feature.data, sizeof(feature.data), NULL);
+}
+
+/* An error of the handler is passed to the host and nothing is returned. */
+ZTEST(hid_usb, test_get_feature_error)
+{
+	int32_t len = 0;
+	uint8_t *data = NULL;
+
+	feature.ret = -EINVAL;
+	zassert_equal(get_report(REPORT_TYPE_FEATURE, FEATURE_ID, &len, &data), -EINVAL, NULL);
+	zassert_equal(len, 0, NULL);
+	zassert_is_null(data, NULL);
+}
+
+/* The report ID in front of the written data is not passed on. */
+ZTEST(hid_usb, test_set_feature)
+{
+	uint8_t buf[] = {FEATURE_ID, 0x10, 0x20, 0x30};
+
+	zassert_ok(set_report(REPORT_TYPE_FEATURE, FEATURE_ID, buf, sizeof(buf)), NULL);
+	zassert_equal(feature.report_id, FEATURE_ID, NULL);
+	zassert_equal(feature.len, sizeof(buf) - 1, NULL);
+	zassert_mem_equal(feature.data, &buf[1], sizeof(buf) - 1, NULL);
+
+	feature.ret = -EINVAL;
+	zassert_equal(set_report(REPORT_TYPE_FEATURE, FEATURE_ID, buf, sizeof(buf)), -EINVAL, NULL);
+}
+
+/* Other report types, empty writes and a missing handler are refused
+ * without calling the handlers.
+ */
+ZTEST(hid_usb, test_refused_requests)
+{
+	uint8_t buf[] = {FEATURE_ID};
+	int32_t len = 0;
+	uint8_t *data = NULL;
+
+	zassert_equal(get_report(REPORT_TYPE_INPUT, 1, &len, &data), -ENOTSUP, NULL);
+	zassert_equal(set_report(REPORT_TYPE_INPUT, 1, buf, sizeof(buf)), -ENOTSUP, NULL);
+	zassert_equal(set_report(REPORT_TYPE_FEATURE, FEATURE_ID, buf, 0), -ENOTSUP, NULL);
+	zassert_equal(feature.calls, 0, NULL);
+
+	hid_usb_set_feature_cb(NULL);
+	zassert_equal(get_report(REPORT_TYPE_FEATURE, FEATURE_ID, &len, &data), -ENOTSUP, NULL);
+	zassert_equal(set_report(REPORT_TYPE_FEATURE, FEATURE_ID, buf, sizeof(buf)), -ENOTSUP, NULL);
+	zassert_equal(feature.calls, 0, NULL);
+}
+
+ZTEST_SUITE(hid_usb, NULL, hid_usb_setup, hid_usb_before, NULL, NULL);
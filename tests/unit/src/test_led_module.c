@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <ztest.h>
+
+#include <app_event_manager.h>
+#include <caf/events/ble_common_event.h>
+
+#include "common.h"
+#include "fake_spi.h"
+
+/* Offsets of the color in the APA102 frame, see led_module.c. */
+#define FRAME_BLUE	5
+#define FRAME_GREEN	6
+#define FRAME_RED	7
+
+/* Long enough for any pattern to play out. */
+#define PATTERN_END_MSEC	3000
+
+static void assert_frame_color(const uint8_t *frame, uint8_t r, uint8_t g, uint8_t b)
+{
+	zassert_equal(frame[FRAME_RED], r, "red is %u", frame[FRAME_RED]);
+	zassert_equal(frame[FRAME_GREEN], g, "green is %u", frame[FRAME_GREEN]);
+	zassert_equal(frame[FRAME_BLUE], b, "blue is %u", frame[FRAME_BLUE]);
+}
+
+static void submit_peer_state(enum peer_state state)
+{
+	struct ble_peer_event *event = new_ble_peer_event();
+
+	event->id = NULL;
+	event->state = state;
+	APP_EVENT_SUBMIT(event);
+}
+
+static void *led_module_setup(void)
+{
+	common_start();
+	k_sleep(K_MSEC(PATTERN_END_MSEC));
+	return NULL;
+}
+
+static void led_module_before(void *fixture)
+{
+	fake_spi_hold(false);
+	fake_spi_reset();
+}
+
+/* Every step of a pattern is one transfer, and the idle black is skipped. */
+ZTEST(led_module, test_one_transfer_per_step)
+{
+	submit_peer_state(PEER_STATE_CONNECTED);
+	k_sleep(K_MSEC(10));
+	zassert_equal(fake_spi_transactions(), 1, NULL);
+	assert_frame_color(fake_spi_last_frame(), 25, 17, 0);
+
+	k_sleep(K_MSEC(PATTERN_END_MSEC));
+	/* Orange, black, orange, black. */
+	zassert_equal(fake_spi_transactions(), 4, NULL);
+	assert_frame_color(fake_spi_last_frame(), 0, 0, 0);
+}
+
+/* A step while the previous frame is still on the bus neither waits for it
+ * nor touches its buffer, and the color is written once the bus is free.
+ */
+ZTEST(led_module, test_busy_bus_retries)
+{
+	const uint8_t *in_flight;
+
+	fake_spi_hold(true);
+	submit_peer_state(PEER_STATE_CONNECTED);
+	k_sleep(K_MSEC(10));
+	zassert_equal(fake_spi_transactions(), 1, NULL);
+
+	/* The black step came due while the orange frame was held. */
+	k_sleep(K_MSEC(600));
+	zassert_equal(fake_spi_transactions(), 1, "Wrote while a transfer was in flight");
+	in_flight = fake_spi_in_flight_buf();
+	zassert_not_null(in_flight, NULL);
+	assert_frame_color(in_flight, 25, 17, 0);
+
+	fake_spi_complete();
+	k_sleep(K_MSEC(5));
+	zassert_equal(fake_spi_transactions(), 2, "Refused write not retried");
+	assert_frame_color(fake_spi_last_frame(), 0, 0, 0);
+
+	fake_spi_hold(false);
+	fake_spi_complete();
+	k_sleep(K_MSEC(PATTERN_END_MSEC));
+	zassert_equal(fake_spi_transactions(), 4, NULL);
+	assert_frame_color(fake_spi_last_frame(), 0, 0, 0);
+}
+
+ZTEST_SUITE(led_module, NULL, led_module_setup, led_module_before, NULL, NULL);
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <ztest.h>
+
+#include "modules_common.h"
+
+#define QUEUE_LEN	8
+/* Enough to overrun the queue many times over, like a burst of peer events. */
+#define FLOOD_MSGS	(50 * QUEUE_LEN)
+
+struct test_msg {
+	uint32_t seq;
+	uint8_t payload[12];
+};
+
+K_MSGQ_DEFINE(test_msgq, sizeof(struct test_msg), QUEUE_LEN, 4);
+
+static struct module_data module = {
+	.name = "test",
+	.msg_q = &test_msgq,
+};
+
+static void enqueue(uint32_t seq, k_timeout_t delay)
+{
+	struct test_msg msg = {
+		.seq = seq,
+	};
+
+	zassert_ok(module_enqueue_msg_with_delay(&module, &msg, delay), "Message %u refused", seq);
+}
+
+static void take_one_handler(struct k_work *work)
+{
+	struct test_msg msg;
+
+	module_get_next_msg_no_wait(&module, &msg);
+}
+
+static K_WORK_DELAYABLE_DEFINE(take_one_work, take_one_handler);
+
+static void modules_common_before(void *fixture)
+{
+	module_purge_queue(&module);
+	atomic_clear(&module.dropped);
+}
+
+/* A flood without a consumer keeps the newest messages, in order, and only
+ * drops the oldest ones.
+ */
+ZTEST(modules_common, test_flood_keeps_newest)
+{
+	struct test_msg msg;
+
+	for (uint32_t i = 0; i < FLOOD_MSGS; i++)
+	{
+		enqueue(i, K_NO_WAIT);
+	}
+
+	zassert_equal(atomic_get(&module.dropped), FLOOD_MSGS - QUEUE_LEN, NULL);
+	for (uint32_t i = FLOOD_MSGS - QUEUE_LEN; i < FLOOD_MSGS; i++)
+	{
+		zassert_ok(module_get_next_msg_no_wait(&module, &msg), NULL);
+		zassert_equal(msg.seq, i, "Got message %u instead of %u", msg.seq, i);
+	}
+	zassert_not_equal(module_get_next_msg_no_wait(&module, &msg), 0, "More than the queue length kept");
+}
+
+/* A consumer that makes room within the delay loses nothing. */
+ZTEST(modules_common, test_delay_waits_for_room)
+{
+	struct test_msg msg;
+
+	for (uint32_t i = 0; i < QUEUE_LEN; i++)
+	{
+		enqueue(i, K_NO_WAIT);
+	}
+
+	k_work_schedule(&take_one_work, K_MSEC(10));
+	enqueue(QUEUE_LEN, K_MSEC(100));
+
+	zassert_equal(atomic_get(&module.dropped), 0, NULL);
+	for (uint32_t i = 1; i <= QUEUE_LEN; i++)
+	{
+		zassert_ok(module_get_next_msg_no_wait(&module, &msg), NULL);
+		zassert_equal(msg.seq, i, NULL);
+	}
+}
+
+ZTEST_SUITE(modules_common, NULL, NULL, modules_common_before, NULL, NULL);
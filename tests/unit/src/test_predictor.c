@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <ztest.h>
+
+#include "predictor.h"
+#include "bench.h"
+
+#define SAMPLE_PERIOD_S	0.01f
+/* Two samples ahead. */
+#define HORIZON_S	0.02f
+#define TOLERANCE	1e-5f
+
+static struct predictor_coeffs coeffs;
+static struct predictor_state state;
+
+/* Feeds a ramp that ends at last, and returns the last prediction. */
+static float run_ramp(float last, float step, int count)
+{
+	float y = 0.0f;
+
+	for (int i = count - 1; i >= 0; i--)
+	{
+		y = predictor_run(&coeffs, &state, last - step * i);
+	}
+	return y;
+}
+
+static void predictor_before(void *fixture)
+{
+	predictor_coeffs_compute(HORIZON_S, 1.0f, SAMPLE_PERIOD_S, &coeffs);
+	predictor_reset(&state);
+}
+
+ZTEST(predictor, test_coeffs)
+{
+	zassert_within(coeffs.horizon, 2.0f, TOLERANCE, NULL);
+	zassert_within(coeffs.max_lead, 1.0f, TOLERANCE, NULL);
+}
+
+/* A constant signal is predicted to stay where it is. */
+ZTEST(predictor, test_constant)
+{
+	zassert_within(run_ramp(0.5f, 0.0f, CONFIG_PREDICTOR_HISTORY), 0.5f, TOLERANCE, NULL);
+}
+
+/* A ramp is extrapolated along its slope. */
+ZTEST(predictor, test_ramp)
+{
+	float y = run_ramp(0.3f, 0.01f, CONFIG_PREDICTOR_HISTORY);
+
+	zassert_within(y, 0.32f, TOLERANCE, "Predicted %f", (double)y);
+	y = run_ramp(-0.3f, -0.01f, CONFIG_PREDICTOR_HISTORY);
+	zassert_within(y, -0.32f, TOLERANCE, "Predicted %f", (double)y);
+}
+
+/* The lead over the newest sample is bounded. */
+ZTEST(predictor, test_max_lead)
+{
+	float y;
+
+	predictor_coeffs_compute(HORIZON_S, 0.05f, SAMPLE_PERIOD_S, &coeffs);
+	y = run_ramp(0.8f, 0.1f, CONFIG_PREDICTOR_HISTORY);
+	zassert_within(y, 0.85f, TOLERANCE, "Predicted %f", (double)y);
+}
+
+/* A signal slowing down is predicted to stop at zero, not to reverse. */
+ZTEST(predictor, test_no_zero_crossing)
+{
+	float y = run_ramp(0.01f, -0.01f, CONFIG_PREDICTOR_HISTORY);
+
+	zassert_within(y, 0.0f, TOLERANCE, "Predicted %f", (double)y);
+}
+
+ZTEST(predictor, test_reset)
+{
+	run_ramp(0.8f, 0.1f, CONFIG_PREDICTOR_HISTORY);
+	predictor_reset(&state);
+	zassert_within(predictor_run(&coeffs, &state, 0.0f), 0.0f, TOLERANCE, NULL);
+}
+
+/* Cycles per sample, which grow with CONFIG_PREDICTOR_HISTORY. */
+ZTEST(predictor, test_benchmark)
+{
+	uint32_t cycles = BENCH_CYCLES(predictor_run(&coeffs, &state,
+						     (bench_i & 0x40) ? 0.8f : 0.3f));
+
+	TC_PRINT("History of %d samples\n", CONFIG_PREDICTOR_HISTORY);
+	BENCH_REPORT("predictor", cycles);
+}
+
+ZTEST_SUITE(predictor, NULL, NULL, predictor_before, NULL, NULL);
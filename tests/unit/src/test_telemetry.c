@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <ztest.h>
+
+#include "telemetry.h"
+#include "bench.h"
+
+/* Frames written back to back, few enough for the buffer to take them all. */
+#define BURST_FRAMES	16
+#define BURSTS		(BENCH_RUNS / BURST_FRAMES)
+/* Console of the plot logging that the telemetry replaced. */
+#define LOG_BAUD	115200
+/* Start, eight data bits and stop. */
+#define BITS_PER_CHAR	10
+
+/* Same layout as struct hid_telemetry in hid_module.c. */
+struct bench_frame {
+	float speed;
+	float speed_clamped;
+	float turn_rate;
+	float output_turn_rate;
+	float difference_sensitivity;
+	float filtered_difference_sensitivity;
+	uint8_t axes[4];
+} __packed;
+
+static const struct bench_frame frame = {
+	.speed = 1.234567f,
+	.speed_clamped = 1.234567f,
+	.turn_rate = -45.678901f,
+	.output_turn_rate = -30.123456f,
+	.difference_sensitivity = 0.654321f,
+	.filtered_difference_sensitivity = 0.712345f,
+	.axes = {0x80, 0x12, 0x80, 0xf0},
+};
+
+static char line[128];
+
+/**
+ * @brief Formats the frame the way the plot logging did, with %f
+ *
+ * @return Length of the line
+ */
+static int format_plot_line(void)
+{
+	return snprintk(line, sizeof(line), "S, SC, UTR, DS, FDS, FRTR = (%f, %f, %f, %f, %f, %f)",
+			(double)frame.speed, (double)frame.speed_clamped, (double)frame.turn_rate,
+			(double)frame.difference_sensitivity,
+			(double)frame.filtered_difference_sensitivity,
+			(double)frame.output_turn_rate);
+}
+
+/* Prints the cost of one telemetry frame next to the cost of the log line
+ * it replaced. The logging formatted the line with floats and, in immediate
+ * mode, waited for the console to send it. The cycle counts only mean
+ * something on a core, on native_posix they stay at zero.
+ */
+ZTEST(telemetry, test_cost_per_record)
+{
+	struct telemetry_stats before;
+	struct telemetry_stats after;
+	uint32_t write_cycles;
+	uint32_t format_cycles;
+	uint32_t frames;
+	int len = format_plot_line();
+	uint32_t uart_us = len * BITS_PER_CHAR * USEC_PER_SEC / LOG_BAUD;
+
+	telemetry_stats_get(&before);
+	for (int i = 0; i < BURSTS; i++)
+	{
+		for (int j = 0; j < BURST_FRAMES; j++)
+		{
+			telemetry_write(TELEMETRY_FRAME_HID, &frame, sizeof(frame));
+		}
+		/* Lets the telemetry thread drain the buffer. */
+		k_sleep(K_MSEC(CONFIG_TELEMETRY_FLUSH_INTERVAL_MS + 1));
+	}
+	telemetry_stats_get(&after);
+
+	frames = after.frames - before.frames;
+	zassert_equal(after.dropped, before.dropped, "Frames dropped, the buffer is too small");
+	zassert_equal(frames, BURSTS * BURST_FRAMES, NULL);
+	write_cycles = (uint32_t)((after.write_cycles - before.write_cycles) / frames);
+
+	format_cycles = BENCH_CYCLES(format_plot_line());
+
+	BENCH_REPORT("telemetry frame", write_cycles);
+	BENCH_REPORT("plot line format", format_cycles);
+	TC_PRINT("plot line output         %d chars, %u us at %u baud\n", len, uart_us, LOG_BAUD);
+
+	if (format_cycles > 0)
+	{
+		zassert_true(write_cycles < format_cycles,
+			     "Frame %u cycles, formatting alone %u", write_cycles, format_cycles);
+	}
+}
+
+ZTEST_SUITE(telemetry, NULL, NULL, NULL, NULL, NULL);